@@ -13,8 +13,8 @@ URHO3D_EVENT(E_BLENDER_MSG, BlenderConnect)
     URHO3D_PARAM(P_TOPIC, Topic);  //string
     URHO3D_PARAM(P_SUBTYPE, SubType); // string
     URHO3D_PARAM(P_DATATYPE, DataType); // string
-    URHO3D_PARAM(P_DATA, Data);  //Custom
-    URHO3D_PARAM(P_META, Meta); // string
+    URHO3D_PARAM(P_MESSAGE, Message); // BlenderMessage* (payload and meta)
+    URHO3D_PARAM(P_CLIENT, Client); // string, empty if blender sent no client id
 }
 
 
@@ -0,0 +1,196 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "NetworkThread.h"
+
+#include <Urho3D/IO/Log.h>
+
+#include <chrono>
+
+/// the thread wakes up at least this often to check if it should stop (ms)
+static const long POLL_TIMEOUT = 100;
+
+NetworkThread::NetworkThread(zmq::context_t& ctx, unsigned queueSize)
+    : ctx_(ctx)
+    , inQueue_(queueSize)
+    , outQueue_(queueSize)
+    , numDropped_(0)
+    , receiveStalled_(false)
+{
+}
+
+NetworkThread::~NetworkThread()
+{
+    Shutdown();
+}
+
+void NetworkThread::SetSecondInSocket(zmq::socket_t&& socket)
+{
+    secondInSocket_ = std::move(socket);
+}
+
+bool NetworkThread::Start(zmq::socket_t&& inSocket, zmq::socket_t&& outSocket)
+{
+    inSocket_ = std::move(inSocket);
+    outSocket_ = std::move(outSocket);
+
+    String wakeEndpoint = "inproc://networkthread-wake-" + String((unsigned long long)(size_t)this);
+    wakeReceiver_ = zmq::socket_t(ctx_, zmq::socket_type::pull);
+    wakeReceiver_.bind(wakeEndpoint.CString());
+    wakeSender_ = zmq::socket_t(ctx_, zmq::socket_type::push);
+    wakeSender_.connect(wakeEndpoint.CString());
+
+    if (!Run()){
+        URHO3D_LOGERROR("NetworkThread: could not start thread");
+        return false;
+    }
+    return true;
+}
+
+void NetworkThread::Shutdown()
+{
+    if (IsStarted()){
+        Stop();
+    }
+    // the thread is gone, so the sockets can be closed from here
+    inSocket_.close();
+    outSocket_.close();
+    secondInSocket_.close();
+    wakeSender_.close();
+    wakeReceiver_.close();
+    ClearQueues();
+}
+
+bool NetworkThread::Send(zmq::multipart_t* message)
+{
+    if (!outQueue_.Push(message)){
+        numDropped_++;
+        URHO3D_LOGERROR("NetworkThread: send queue is full, message dropped");
+        delete message;
+        return false;
+    }
+    wakeSender_.send(zmq::message_t(),zmq::send_flags::dontwait);
+    return true;
+}
+
+bool NetworkThread::Receive(zmq::multipart_t*& message, unsigned long long* receiveTime)
+{
+    ReceivedMessage received;
+    if (!inQueue_.Pop(received)){
+        return false;
+    }
+    message = received.multipart_;
+    if (receiveStalled_.exchange(false)){
+        wakeSender_.send(zmq::message_t(),zmq::send_flags::dontwait);
+    }
+    if (receiveTime){
+        *receiveTime = received.receiveTime_;
+    }
+    return true;
+}
+
+bool NetworkThread::WaitForMessages(unsigned timeoutMs)
+{
+    std::unique_lock<std::mutex> lock(waitMutex_);
+    return messageQueued_.wait_for(lock,std::chrono::milliseconds(timeoutMs),[this]{ return !inQueue_.Empty(); });
+}
+
+void NetworkThread::ThreadFunction()
+{
+    while (shouldRun_){
+        zmq::pollitem_t items[] = {
+            { static_cast<void*>(wakeReceiver_), 0, ZMQ_POLLIN, 0 },
+            { static_cast<void*>(inSocket_), 0, ZMQ_POLLIN, 0 },
+            { static_cast<void*>(secondInSocket_), 0, ZMQ_POLLIN, 0 }
+        };
+        // with a full receive queue only the wake socket is polled, everything else stays in the sockets
+        // (and their high water marks push back to the sender) until the main thread catches up
+        int numItems = secondInSocket_ ? 3 : 2;
+        if (inQueue_.Full()){
+            receiveStalled_ = true;
+            // the main thread may have taken a message before it could see the flag
+            if (inQueue_.Full()){
+                numItems = 1;
+            } else {
+                receiveStalled_ = false;
+            }
+        }
+        zmq::poll(items,numItems,POLL_TIMEOUT);
+
+        if (items[0].revents & ZMQ_POLLIN){
+            zmq::message_t wake;
+            while (wakeReceiver_.recv(wake,zmq::recv_flags::dontwait)){
+            }
+        }
+        if (numItems > 1 && (items[1].revents & ZMQ_POLLIN)){
+            ReceiveAll(inSocket_);
+        }
+        if (numItems > 2 && (items[2].revents & ZMQ_POLLIN)){
+            ReceiveAll(secondInSocket_);
+        }
+
+        zmq::multipart_t* message;
+        while (outQueue_.Pop(message)){
+            message->send(outSocket_);
+            delete message;
+        }
+    }
+}
+
+void NetworkThread::ReceiveAll(zmq::socket_t& socket)
+{
+    zmq::multipart_t* message = new zmq::multipart_t();
+    bool queued = false;
+    // only this thread pushes, so there is room for the message once it is received
+    while (!inQueue_.Full()){
+        if (!message->recv(socket,ZMQ_DONTWAIT)){
+            break;
+        }
+
+        ReceivedMessage received;
+        received.multipart_ = message;
+        received.receiveTime_ = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        inQueue_.Push(received);
+        queued = true;
+        message = new zmq::multipart_t();
+    }
+    delete message;
+
+    if (queued){
+        // taking the lock makes sure the main thread is either waiting or will see the message
+        { std::lock_guard<std::mutex> lock(waitMutex_); }
+        messageQueued_.notify_one();
+    }
+}
+
+void NetworkThread::ClearQueues()
+{
+    ReceivedMessage received;
+    while (inQueue_.Pop(received)){
+        delete received.multipart_;
+    }
+    zmq::multipart_t* message;
+    while (outQueue_.Pop(message)){
+        delete message;
+    }
+}
@@ -0,0 +1,95 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Core/Thread.h>
+#include <3rd/cppzmq/zmq.hpp>
+#include <3rd/cppzmq/zmq_addon.hpp>
+
+#include "SPSCQueue.h"
+
+#include <condition_variable>
+#include <mutex>
+
+using namespace Urho3D;
+
+/// A message received by the network thread.
+struct ReceivedMessage
+{
+    zmq::multipart_t* multipart_;
+    /// steady clock in microseconds when the message was taken from the socket
+    unsigned long long receiveTime_;
+};
+
+/// Owns the sockets of a pub/sub connection and does all receiving and sending on its own
+/// thread, so the main thread never blocks on the network. Received messages are handed to the
+/// main thread and outgoing ones back through lock-free queues. Sockets are created by the caller
+/// and must not be touched anymore after Start().
+class NetworkThread : public Thread
+{
+public:
+    NetworkThread(zmq::context_t& ctx,unsigned queueSize=1024);
+    ~NetworkThread() override;
+
+    /// Additionally receive from this socket, e.g. a subscription that only carries latency sensitive messages so
+    /// they don't queue behind bulk data on the in socket. Call before Start().
+    void SetSecondInSocket(zmq::socket_t&& socket);
+    /// Take over the sockets and start the thread.
+    bool Start(zmq::socket_t&& inSocket,zmq::socket_t&& outSocket);
+    /// Stop the thread and close the sockets. Messages still queued are dropped.
+    void Shutdown();
+
+    /// Main thread: queue a message for sending. Takes ownership. Returns false if the queue is full (message is dropped).
+    bool Send(zmq::multipart_t* message);
+    /// Main thread: next received message (caller owns it) or false if there is none.
+    bool Receive(zmq::multipart_t*& message,unsigned long long* receiveTime=nullptr);
+    /// Main thread: block until a received message is queued or timeoutMs passed. Returns true if there is one.
+    bool WaitForMessages(unsigned timeoutMs);
+    /// Messages dropped because the send queue was full (the main thread sends faster than the network). Received
+    /// messages are never dropped here: while the receive queue is full they stay in the sockets.
+    inline unsigned GetNumDropped() const { return numDropped_; }
+
+    void ThreadFunction() override;
+
+private:
+    /// take what is available from the socket, as long as the receive queue has room (network thread)
+    void ReceiveAll(zmq::socket_t& socket);
+    void ClearQueues();
+
+    zmq::context_t& ctx_;
+    zmq::socket_t inSocket_;
+    zmq::socket_t outSocket_;
+    zmq::socket_t secondInSocket_;
+    /// main thread -> network thread: there is something to send (inproc push/pull pair)
+    zmq::socket_t wakeSender_;
+    zmq::socket_t wakeReceiver_;
+    SPSCQueue<ReceivedMessage> inQueue_;
+    SPSCQueue<zmq::multipart_t*> outQueue_;
+    /// network thread -> main thread: a message was queued (see WaitForMessages())
+    std::mutex waitMutex_;
+    std::condition_variable messageQueued_;
+    std::atomic<unsigned> numDropped_;
+    /// set by the network thread when it stopped reading because the receive queue is full, the main thread
+    /// wakes it up after taking a message
+    std::atomic<bool> receiveStalled_;
+};
@@ -27,6 +27,8 @@
 #include <CommonEvents.h>
 #include <Urho3D/Resource/JSONFile.h>
 #include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/IO/Log.h>
 
 
 PubSubMessage::PubSubMessage(Context* ctx, const zmq::multipart_t& msg)
@@ -63,6 +65,9 @@ JSONObject PubSubMessage::PopJson()
 
 PubSubNetwork::PubSubNetwork(Context* context) :
     Object(context)
+    ,numReceived_(0)
+    ,numSent_(0)
+    ,bytesSent_(0)
     ,running_(false)
     ,initialized_(false)
 {
@@ -86,24 +91,81 @@ void PubSubNetwork::RegisterObject(Context* context)
 
 void PubSubNetwork::InitNetwork(const String& host, const String& initialFilter,int portOut, int portIn)
 {
-    inSocket_ = zmq::socket_t(ctx, zmq::socket_type::sub);
-    inSocket_.connect(("tcp://"+host+":"+String(portIn)).CString());
-
-    inSocket_.setsockopt(ZMQ_SUBSCRIBE, initialFilter.CString(),initialFilter.Length());
-    //inSocket_.setsockopt(ZMQ_RCVTIMEO, 0);
+    NetworkConfig config;
+    config.inEndpoint_ = "tcp://"+host+":"+String(portIn);
+    config.outEndpoint_ = "tcp://"+host+":"+String(portOut);
+    InitNetwork(config,initialFilter);
+}
 
-    outSocket_ = zmq::socket_t(ctx, zmq::socket_type::pub);
-    outSocket_.connect(("tcp://"+host+":"+String(portOut)).CString());
+static void SetSocketOptions(zmq::socket_t& socket,const NetworkConfig& config)
+{
+    // options have to be set before connecting
+    if (config.receiveHWM_ > 0){
+        socket.setsockopt(ZMQ_RCVHWM,config.receiveHWM_);
+    }
+    if (config.sendHWM_ > 0){
+        socket.setsockopt(ZMQ_SNDHWM,config.sendHWM_);
+    }
+    if (config.receiveBuffer_ > 0){
+        socket.setsockopt(ZMQ_RCVBUF,config.receiveBuffer_);
+    }
+    if (config.sendBuffer_ > 0){
+        socket.setsockopt(ZMQ_SNDBUF,config.sendBuffer_);
+    }
+}
 
+void PubSubNetwork::InitNetwork(const NetworkConfig& config, const String& initialFilter)
+{
+    try {
+        zmq::socket_t inSocket(ctx, zmq::socket_type::sub);
+        SetSocketOptions(inSocket,config);
+        inSocket.setsockopt(ZMQ_SUBSCRIBE, initialFilter.CString(),initialFilter.Length());
+        for (const String& filter : config.subscriptions_){
+            inSocket.setsockopt(ZMQ_SUBSCRIBE, filter.CString(),filter.Length());
+        }
+        inSocket.connect(config.inEndpoint_.CString());
+
+        zmq::socket_t outSocket(ctx, zmq::socket_type::pub);
+        SetSocketOptions(outSocket,config);
+        outSocket.connect(config.outEndpoint_.CString());
+
+        networkThread_ = new NetworkThread(ctx);
+
+        if (!config.viewEndpoint_.Empty()){
+            // no ZMQ_CONFLATE: it keeps one message for the whole socket, updates of all but the
+            // last view would be lost. the receiver coalesces per view instead
+            zmq::socket_t viewSocket(ctx, zmq::socket_type::sub);
+            SetSocketOptions(viewSocket,config);
+            viewSocket.setsockopt(ZMQ_SUBSCRIBE, initialFilter.CString(),initialFilter.Length());
+            for (const String& filter : config.subscriptions_){
+                viewSocket.setsockopt(ZMQ_SUBSCRIBE, filter.CString(),filter.Length());
+            }
+            viewSocket.connect(config.viewEndpoint_.CString());
+            networkThread_->SetSecondInSocket(std::move(viewSocket));
+        }
+
+        initialized_ = networkThread_->Start(std::move(inSocket),std::move(outSocket));
+    }
+    catch (const zmq::error_t& e){
+        URHO3D_LOGERRORF("PubSubNetwork: could not connect (in:%s out:%s): %s",config.inEndpoint_.CString(),config.outEndpoint_.CString(),e.what());
+        networkThread_.Reset();
+        initialized_ = false;
+    }
+    if (initialized_){
+        URHO3D_LOGINFOF("PubSubNetwork: in:%s out:%s",config.inEndpoint_.CString(),config.outEndpoint_.CString());
+    }
 }
 
 void PubSubNetwork::CheckNetwork()
 {
-    zmq::multipart_t multipart;
+    if (!initialized_){
+        return;
+    }
 
-    auto ok = multipart.recv(inSocket_, ZMQ_DONTWAIT);
-    if (ok){
-        PubSubMessage msg(context_,multipart);
+    zmq::multipart_t* multipart;
+    while (ReceiveMultipart(multipart)){
+        PubSubMessage msg(context_,*multipart);
+        delete multipart;
 
         using namespace NSPubSubMessage;
         VariantMap map;
@@ -114,6 +176,15 @@ void PubSubNetwork::CheckNetwork()
 
 }
 
+bool PubSubNetwork::WaitForMessages(unsigned timeoutMs)
+{
+    if (!initialized_){
+        Time::Sleep(timeoutMs);
+        return false;
+    }
+    return networkThread_->WaitForMessages(timeoutMs);
+}
+
 void PubSubNetwork::HandleBeginFrame(StringHash eventType, VariantMap &eventData)
 {
     CheckNetwork();
@@ -121,33 +192,86 @@ void PubSubNetwork::HandleBeginFrame(StringHash eventType, VariantMap &eventData
 
 void PubSubNetwork::Close()
 {
-    inSocket_.close();
-    outSocket_.close();
+    StopRecording();
+    if (networkThread_){
+        networkThread_->Shutdown();
+        networkThread_.Reset();
+    }
+    initialized_ = false;
     ctx.close();
 }
 
+bool PubSubNetwork::ReceiveMultipart(zmq::multipart_t*& multipart, unsigned long long* receiveTime)
+{
+    unsigned long long time;
+    if (!initialized_ || !networkThread_->Receive(multipart,&time)){
+        return false;
+    }
+    numReceived_++;
+    if (recorder_){
+        recorder_->Write(*multipart,time);
+    }
+    if (receiveTime){
+        *receiveTime = time;
+    }
+    return true;
+}
+
+bool PubSubNetwork::StartRecording(const String& path)
+{
+    recorder_ = new SessionRecorder(context_);
+    if (!recorder_->Open(path)){
+        recorder_.Reset();
+        return false;
+    }
+    return true;
+}
+
+void PubSubNetwork::StopRecording()
+{
+    recorder_.Reset();
+}
+
+unsigned PubSubNetwork::GetNumDropped() const
+{
+    return networkThread_ ? networkThread_->GetNumDropped() : 0;
+}
+
+bool PubSubNetwork::SendMultipart(zmq::multipart_t* multipart)
+{
+    if (!initialized_){
+        delete multipart;
+        return false;
+    }
+    numSent_++;
+    for (size_t i=0; i < multipart->size(); i++){
+        bytesSent_ += multipart->peek(i)->size();
+    }
+    return networkThread_->Send(multipart);
+}
+
 void PubSubNetwork::Send(const String& topic,const String& txtData,void* buffer,int length)
 {
-    zmq::multipart_t multipart;
-    multipart.addstr(topic.CString());
-    multipart.addstr(txtData.CString());
+    zmq::multipart_t* multipart = new zmq::multipart_t();
+    multipart->addstr(topic.CString());
+    multipart->addstr(txtData.CString());
     if (buffer && length){
-        multipart.add(zmq::message_t(buffer,length));
+        multipart->add(zmq::message_t(buffer,length));
     }
-    multipart.send(outSocket_);
+    SendMultipart(multipart);
 }
 void PubSubNetwork::Send(const String& topic,const StringVector& txtData,void* buffer,int length)
 {
-    zmq::multipart_t multipart;
+    zmq::multipart_t* multipart = new zmq::multipart_t();
 
-    multipart.addstr(topic.CString());
+    multipart->addstr(topic.CString());
     for (const String  txt : txtData){
-        multipart.addstr(txt.CString());
+        multipart->addstr(txt.CString());
     }
     if (buffer && length){
-        multipart.add(zmq::message_t(buffer,length));
+        multipart->add(zmq::message_t(buffer,length));
     }
-    multipart.send(outSocket_);
+    SendMultipart(multipart);
 
 }
 
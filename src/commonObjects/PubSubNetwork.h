@@ -28,7 +28,10 @@
 #include <3rd/cppzmq/zmq.hpp>
 #include <3rd/cppzmq/zmq_addon.hpp>
 #include <Urho3D/Resource/JSONValue.h>
+#include <Urho3D/IO/VectorBuffer.h>
 
+#include "NetworkThread.h"
+#include "SessionLog.h"
 
 using namespace Urho3D;
 
@@ -48,6 +51,35 @@ private:
 };
 
 
+/// Endpoints and socket options of a PubSubNetwork. Endpoints are zeromq addresses
+/// (tcp://host:port, ipc:///path for unix domain sockets, inproc://name within the process).
+struct NetworkConfig
+{
+    NetworkConfig()
+        : receiveHWM_(0)
+        , sendHWM_(0)
+        , receiveBuffer_(0)
+        , sendBuffer_(0)
+    {}
+
+    /// the sub socket connects here
+    String inEndpoint_;
+    /// the pub socket connects here
+    String outEndpoint_;
+    /// optional second sub socket with the same subscriptions, for messages that must not queue
+    /// behind the traffic of the in endpoint (e.g. camera updates)
+    String viewEndpoint_;
+    /// topic prefixes the sub socket subscribes to in addition to the initial filter
+    StringVector subscriptions_;
+    /// socket options, 0 keeps the zeromq default
+    int receiveHWM_;
+    int sendHWM_;
+    int receiveBuffer_;
+    int sendBuffer_;
+};
+
+/// Pub/sub connection whose sockets live on a NetworkThread. Received messages are sent as
+/// E_PUBSUB_MSG, subclasses can override CheckNetwork() to process them differently.
 class PubSubNetwork : public Object
 {
     URHO3D_OBJECT(PubSubNetwork, Object);
@@ -59,21 +91,50 @@ public:
     /// Register object factory and attributes.
     static void RegisterObject(Context* context);
 
-    void InitNetwork(const String& host,const String& initialFilter, int portIn, int portOut);
-    void CheckNetwork();
-    void Close();
+    void InitNetwork(const String& host,const String& initialFilter, int portOut, int portIn);
+    void InitNetwork(const NetworkConfig& config,const String& initialFilter);
+    /// Handle the messages received since the last call. Called every frame.
+    virtual void CheckNetwork();
+    virtual void Close();
     /// Handle begin frame event.
     void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
     void Send(const String& topic,const String& txtData,void* buffer=0,int length=0);
     void Send(const String& topic,const StringVector& txtData,void* buffer=0,int length=0);
 
+    /// counters since start, for statistics
+    inline unsigned long long GetNumReceived() const { return numReceived_; }
+    inline unsigned long long GetNumSent() const { return numSent_; }
+    inline unsigned long long GetBytesSent() const { return bytesSent_; }
+    unsigned GetNumDropped() const;
+    /// Block until a message was received or timeoutMs passed, so an idle main loop doesn't spin.
+    /// Returns true if a message is waiting (it is handled with the next CheckNetwork()).
+    bool WaitForMessages(unsigned timeoutMs);
+    /// the zeromq context, inproc endpoints only work within it
+    inline zmq::context_t& GetZMQContext() { return ctx; }
+
+    /// Write every received message to a session log (see SessionRecorder) until StopRecording() or Close().
+    bool StartRecording(const String& path);
+    void StopRecording();
+
+
+protected:
+    /// next message received by the network thread (caller owns it), false if there is none
+    bool ReceiveMultipart(zmq::multipart_t*& multipart,unsigned long long* receiveTime=nullptr);
+    /// hand the message over to the network thread. Takes ownership. Returns false if it was dropped.
+    bool SendMultipart(zmq::multipart_t* multipart);
+    inline bool IsInitialized() const { return initialized_; }
+
+    unsigned long long numReceived_;
+    unsigned long long numSent_;
+    unsigned long long bytesSent_;
 
 private:
     bool running_;
-    zmq::socket_t  inSocket_;
-    zmq::socket_t  outSocket_;
     bool initialized_;
     zmq::context_t ctx;
+    /// owns the sockets, all sending and receiving happens there
+    UniquePtr<NetworkThread> networkThread_;
+    UniquePtr<SessionRecorder> recorder_;
 
 };
 
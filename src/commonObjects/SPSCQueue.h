@@ -0,0 +1,80 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Container/Vector.h>
+#include <Urho3D/Math/MathDefs.h>
+
+#include <atomic>
+
+using namespace Urho3D;
+
+/// Lock-free bounded queue for exactly one producer thread and one consumer thread.
+template <class T> class SPSCQueue
+{
+public:
+    /// capacity is rounded up to the next power of two
+    explicit SPSCQueue(unsigned capacity)
+        : head_(0)
+        , tail_(0)
+    {
+        buffer_.Resize(NextPowerOfTwo(Max(capacity,2U)));
+        mask_ = buffer_.Size() - 1;
+    }
+
+    /// Producer: append a value. Returns false if the queue is full.
+    bool Push(const T& value)
+    {
+        unsigned tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == buffer_.Size()){
+            return false;
+        }
+        buffer_[tail & mask_] = value;
+        tail_.store(tail + 1,std::memory_order_release);
+        return true;
+    }
+
+    /// Consumer: take the oldest value. Returns false if the queue is empty.
+    bool Pop(T& value)
+    {
+        unsigned head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)){
+            return false;
+        }
+        value = buffer_[head & mask_];
+        head_.store(head + 1,std::memory_order_release);
+        return true;
+    }
+
+    bool Empty() const { return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire); }
+    /// Producer: true if the next Push() would fail.
+    bool Full() const { return tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_acquire) == buffer_.Size(); }
+
+private:
+    PODVector<T> buffer_;
+    unsigned mask_;
+    /// next index to read (written by the consumer only)
+    alignas(64) std::atomic<unsigned> head_;
+    /// next index to write (written by the producer only)
+    alignas(64) std::atomic<unsigned> tail_;
+};
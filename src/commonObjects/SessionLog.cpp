@@ -0,0 +1,176 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "SessionLog.h"
+
+#include <Urho3D/IO/Log.h>
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+static const char* MAGIC = "U3DR";
+
+/// give the subscribers time to connect before the first message (pub/sub drops messages without subscriber)
+static const unsigned REPLAY_STARTUP_DELAY = 500;
+
+SessionRecorder::SessionRecorder(Context* context)
+    : context_(context)
+    , numRecords_(0)
+{
+}
+
+SessionRecorder::~SessionRecorder()
+{
+    Close();
+}
+
+bool SessionRecorder::Open(const String& path)
+{
+    file_ = new File(context_);
+    if (!file_->Open(path,FILE_WRITE)){
+        URHO3D_LOGERRORF("SessionRecorder: could not open %s",path.CString());
+        file_.Reset();
+        return false;
+    }
+    file_->Write(MAGIC,4);
+    file_->WriteUInt(VERSION);
+    numRecords_ = 0;
+    URHO3D_LOGINFOF("SessionRecorder: recording to %s",path.CString());
+    return true;
+}
+
+void SessionRecorder::Close()
+{
+    if (file_){
+        file_->Close();
+        file_.Reset();
+        URHO3D_LOGINFOF("SessionRecorder: %u messages recorded",numRecords_);
+    }
+}
+
+void SessionRecorder::Write(const zmq::multipart_t& multipart, unsigned long long receiveTime)
+{
+    if (!IsOpen()){
+        return;
+    }
+    file_->Write(&receiveTime,sizeof(receiveTime));
+    file_->WriteUInt((unsigned)multipart.size());
+    for (size_t i=0; i < multipart.size(); i++){
+        const zmq::message_t* frame = multipart.peek(i);
+        file_->WriteUInt((unsigned)frame->size());
+        file_->Write(frame->data(),(unsigned)frame->size());
+    }
+    numRecords_++;
+}
+
+SessionReplayer::SessionReplayer(Context* context, zmq::context_t& ctx)
+    : context_(context)
+    , ctx_(ctx)
+    , speed_(1.0f)
+    , finished_(false)
+    , numReplayed_(0)
+{
+}
+
+SessionReplayer::~SessionReplayer()
+{
+    Stop();
+    socket_.close();
+}
+
+bool SessionReplayer::Start(const String& path, const String& endpoint, float speed)
+{
+    file_ = new File(context_);
+    char magic[4];
+    if (!file_->Open(path,FILE_READ) || file_->Read(magic,4)!=4 || memcmp(magic,MAGIC,4)!=0 || file_->ReadUInt() != SessionRecorder::VERSION){
+        URHO3D_LOGERRORF("SessionReplayer: %s is not a session log",path.CString());
+        file_.Reset();
+        return false;
+    }
+    speed_ = Max(speed,0.0f);
+
+    try {
+        socket_ = zmq::socket_t(ctx_, zmq::socket_type::pub);
+        // a replay must not lose messages, whatever the speed
+        socket_.setsockopt(ZMQ_SNDHWM,0);
+        socket_.bind(endpoint.CString());
+    }
+    catch (const zmq::error_t& e){
+        URHO3D_LOGERRORF("SessionReplayer: could not bind %s: %s",endpoint.CString(),e.what());
+        return false;
+    }
+
+    URHO3D_LOGINFOF("SessionReplayer: replaying %s on %s (speed:%.2f)",path.CString(),endpoint.CString(),speed_);
+    return Run();
+}
+
+bool SessionReplayer::ReadRecord(zmq::multipart_t& multipart, unsigned long long& receiveTime)
+{
+    multipart.clear();
+    if (file_->Read(&receiveTime,sizeof(receiveTime)) != sizeof(receiveTime)){
+        return false;
+    }
+    unsigned numFrames = file_->ReadUInt();
+    for (unsigned i=0; i < numFrames; i++){
+        unsigned size = file_->ReadUInt();
+        zmq::message_t frame(size);
+        if (file_->Read(frame.data(),size) != size){
+            URHO3D_LOGERROR("SessionReplayer: log is truncated");
+            return false;
+        }
+        multipart.add(std::move(frame));
+    }
+    return true;
+}
+
+void SessionReplayer::ThreadFunction()
+{
+    using namespace std::chrono;
+
+    std::this_thread::sleep_for(milliseconds(REPLAY_STARTUP_DELAY));
+
+    zmq::multipart_t multipart;
+    unsigned long long receiveTime;
+    unsigned long long firstReceiveTime = 0;
+    steady_clock::time_point start = steady_clock::now();
+
+    while (shouldRun_ && ReadRecord(multipart,receiveTime)){
+        if (!numReplayed_){
+            firstReceiveTime = receiveTime;
+        }
+        if (speed_ > 0){
+            // keep the recorded distance to the first message, in short steps to react to Stop()
+            steady_clock::time_point due = start + microseconds((long long)((receiveTime - firstReceiveTime) / (double)speed_));
+            while (shouldRun_ && steady_clock::now() < due){
+                steady_clock::time_point step = steady_clock::now() + milliseconds(100);
+                std::this_thread::sleep_until(due < step ? due : step);
+            }
+        }
+        multipart.send(socket_);
+        numReplayed_++;
+    }
+
+    URHO3D_LOGINFOF("SessionReplayer: %u messages replayed in %.2fs",(unsigned)numReplayed_,
+                    duration_cast<microseconds>(steady_clock::now() - start).count() / 1000000.0f);
+    finished_ = true;
+}
@@ -0,0 +1,92 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Container/Ptr.h>
+#include <Urho3D/Core/Thread.h>
+#include <Urho3D/IO/File.h>
+#include <3rd/cppzmq/zmq.hpp>
+#include <3rd/cppzmq/zmq_addon.hpp>
+
+#include <atomic>
+
+using namespace Urho3D;
+
+/// Binary log of received pub/sub messages:
+///
+///   header  char[4]  magic "U3DR"
+///           uint32   version
+///   record  uint64   receive time (usec, steady clock of the recording machine)
+///           uint32   number of frames
+///           frames   uint32 size + data, for each frame
+///
+/// All values are little endian.
+class SessionRecorder
+{
+public:
+    static const unsigned VERSION = 1;
+
+    explicit SessionRecorder(Context* context);
+    ~SessionRecorder();
+
+    bool Open(const String& path);
+    void Close();
+    inline bool IsOpen() const { return file_ && file_->IsOpen(); }
+    /// Append the message as it was received.
+    void Write(const zmq::multipart_t& multipart,unsigned long long receiveTime);
+    inline unsigned GetNumRecords() const { return numRecords_; }
+
+private:
+    Context* context_;
+    SharedPtr<File> file_;
+    unsigned numRecords_;
+};
+
+/// Publishes a SessionRecorder log on a local pub socket, with the recorded timing scaled by
+/// speed or as fast as possible (speed 0). Runs on its own thread.
+class SessionReplayer : public Thread
+{
+public:
+    SessionReplayer(Context* context,zmq::context_t& ctx);
+    ~SessionReplayer() override;
+
+    /// Open the log, bind the pub socket and start publishing.
+    bool Start(const String& path,const String& endpoint,float speed=1.0f);
+    /// true once every record was published
+    inline bool IsFinished() const { return finished_; }
+    inline unsigned GetNumReplayed() const { return numReplayed_; }
+
+    void ThreadFunction() override;
+
+private:
+    /// read the next record into multipart, false at the end of the log
+    bool ReadRecord(zmq::multipart_t& multipart,unsigned long long& receiveTime);
+
+    Context* context_;
+    zmq::context_t& ctx_;
+    zmq::socket_t socket_;
+    SharedPtr<File> file_;
+    float speed_;
+    std::atomic<bool> finished_;
+    std::atomic<unsigned> numReplayed_;
+};
@@ -0,0 +1,347 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "BenchmarkClient.h"
+#include "FrameHeader.h"
+#include "ViewMessage.h"
+
+#include <Urho3D/Graphics/CustomGeometry.h>
+#include <Urho3D/Graphics/Light.h>
+#include <Urho3D/Graphics/Octree.h>
+#include <Urho3D/Graphics/Zone.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Resource/JSONFile.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include <chrono>
+#include <thread>
+
+const char* BenchmarkClient::IN_ENDPOINT = "inproc://benchmark-in";
+const char* BenchmarkClient::OUT_ENDPOINT = "inproc://benchmark-out";
+const char* BenchmarkClient::SCENE_NAME = "benchmark";
+
+/// time for the runtime to connect and subscribe before the first message
+static const unsigned STARTUP_DELAY = 500;
+/// seconds per run before measuring (resize, first frames)
+static const float WARMUP_TIME = 1.0f;
+/// usec to receive the frames of a run's last updates before the next run starts
+static const unsigned long long DRAIN_TIME = 250000;
+/// seconds between the runtime's stats, rendered frames are taken from them
+static const float STATS_INTERVAL = 0.25f;
+
+/// camera orbit in blender coordinates, once per ORBIT_TIME usec
+static const float ORBIT_RADIUS = 40.0f;
+static const float ORBIT_HEIGHT = 15.0f;
+static const unsigned long long ORBIT_TIME = 10000000;
+
+static const unsigned MAX_VIEWS = 8;
+
+BenchmarkClient::BenchmarkClient(Context* context, zmq::context_t& ctx)
+    : context_(context)
+    , ctx_(ctx)
+    , runDuration_(3.0f)
+    , numViewsCreated_(0)
+    , inputSeq_(0)
+    , finished_(false)
+{
+}
+
+BenchmarkClient::~BenchmarkClient()
+{
+    Stop();
+    pubSocket_.close();
+    subSocket_.close();
+}
+
+void BenchmarkClient::AddRun(unsigned numViews, int width, int height, float updateRate)
+{
+    BenchmarkRun run;
+    run.numViews_ = Clamp(numViews,1U,MAX_VIEWS);
+    run.width_ = width;
+    run.height_ = height;
+    run.updateRate_ = Max(updateRate,1.0f);
+    runs_.Push(run);
+}
+
+void BenchmarkClient::AddDefaultSweep()
+{
+    static const int resolutions[][2] = { {640,480}, {1280,720}, {1920,1080}, {3840,2160} };
+    static const float rates[] = { 30.0f, 60.0f };
+
+    for (unsigned numViews = 1; numViews <= MAX_VIEWS; numViews *= 2){
+        for (const int* resolution : resolutions){
+            for (float rate : rates){
+                AddRun(numViews,resolution[0],resolution[1],rate);
+            }
+        }
+    }
+}
+
+bool BenchmarkClient::Start()
+{
+    try {
+        pubSocket_ = zmq::socket_t(ctx_, zmq::socket_type::pub);
+        pubSocket_.setsockopt(ZMQ_SNDHWM,0);
+        pubSocket_.bind(IN_ENDPOINT);
+
+        subSocket_ = zmq::socket_t(ctx_, zmq::socket_type::sub);
+        subSocket_.setsockopt(ZMQ_RCVHWM,0);
+        subSocket_.setsockopt(ZMQ_SUBSCRIBE,"",0);
+        subSocket_.bind(OUT_ENDPOINT);
+    }
+    catch (const zmq::error_t& e){
+        URHO3D_LOGERRORF("BenchmarkClient: could not bind: %s",e.what());
+        return false;
+    }
+
+    URHO3D_LOGINFOF("BenchmarkClient: %u runs, %.1fs each",runs_.Size(),runDuration_);
+    return Run();
+}
+
+void BenchmarkClient::ThreadFunction()
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(STARTUP_DELAY));
+
+    // raw full frames, so the numbers only depend on rendering and transport
+    SendJSON("settings","{\"show_physics\":false,\"show_physics_depth\":false,\"activate_physics\":false,"
+                        "\"binary_header\":true,\"delta_tiles\":false,\"codec\":\"raw\",\"progressive\":false,"
+                        "\"dynamic_resolution\":false,\"metrics_interval\":" + String(STATS_INTERVAL) + "}");
+
+    for (unsigned i=0; shouldRun_ && i < runs_.Size(); i++){
+        BenchmarkRun& run = runs_[i];
+        URHO3D_LOGINFOF("BenchmarkClient: run %u/%u: %u views %ix%i %.0fHz",i+1,runs_.Size(),
+                        run.numViews_,run.width_,run.height_,run.updateRate_);
+
+        // views are only created once, later runs resize them with their first updates
+        for (; numViewsCreated_ < run.numViews_; numViewsCreated_++){
+            SendJSON("data_change","{\"view_id\":" + String(numViewsCreated_) + ",\"scene_name\":\"" + SCENE_NAME
+                     + "\",\"resolution\":{\"width\":" + String(run.width_) + ",\"height\":" + String(run.height_)
+                     + "},\"fov\":45.0}");
+        }
+
+        Execute(run,WARMUP_TIME,false);
+        Execute(run,runDuration_,true);
+        Receive(DRAIN_TIME,nullptr);
+    }
+
+    finished_ = true;
+}
+
+void BenchmarkClient::Execute(BenchmarkRun& run, float duration, bool measure)
+{
+    unsigned long long start = GetMonotonicUSec();
+    unsigned long long end = start + (unsigned long long)(duration * 1000000.0f);
+    unsigned long long interval = (unsigned long long)(1000000.0f / run.updateRate_);
+    unsigned long long nextUpdate = start;
+
+    unsigned long long now;
+    while (shouldRun_ && (now = GetMonotonicUSec()) < end){
+        if (now >= nextUpdate){
+            for (unsigned i=0; i < run.numViews_; i++){
+                // resize while warming up, measured updates only move the camera
+                SendView(i,run,!measure,now);
+            }
+            nextUpdate = Max(nextUpdate + interval,now);
+        }
+        Receive(Min(nextUpdate,end) - now,measure ? &run : nullptr);
+    }
+
+    if (measure){
+        run.duration_ = (GetMonotonicUSec() - start) / 1000000.0f;
+    }
+}
+
+void BenchmarkClient::Receive(unsigned long long timeout, BenchmarkRun* run)
+{
+    zmq::pollitem_t item = { static_cast<void*>(subSocket_), 0, ZMQ_POLLIN, 0 };
+    if (zmq::poll(&item,1,(long)(timeout / 1000)) <= 0){
+        return;
+    }
+
+    zmq::multipart_t multipart;
+    while (multipart.recv(subSocket_,ZMQ_DONTWAIT)){
+        std::string topic = multipart.peekstr(0);
+        if (topic == "runtime stats json"){
+            HandleStats(multipart,run);
+        }
+        else if (topic.compare(0,8,"runtime-") == 0){
+            HandleFrame(multipart,run);
+        }
+    }
+}
+
+void BenchmarkClient::HandleFrame(zmq::multipart_t& multipart, BenchmarkRun* run)
+{
+    if (multipart.size() != 3){
+        return;
+    }
+    const zmq::message_t* data = multipart.peek(1);
+    FrameHeader header;
+    if (!header.ReadBinary(data->data<unsigned char>(),(unsigned)data->size())){
+        return;
+    }
+    unsigned sequence = header.info_.sequence_;
+    unsigned long long clientTime = header.info_.trace_.clientTime_;
+    unsigned inputSeq = header.info_.trace_.inputSeq_;
+
+    // 'runtime-<view id> frame bin'
+    String topic(multipart.peekstr(0).c_str());
+    int viewId = ToInt(topic.Substring(8,topic.Find(' ') - 8));
+    SendJSON("ack","{\"view_id\":" + String(viewId) + ",\"seq\":" + String(sequence) + "}");
+
+    if (run){
+        run->deliveredFrames_++;
+        run->deliveredBytes_ += multipart.peek(2)->size();
+        if (inputSeq){
+            run->latency_.Add((unsigned)(GetMonotonicUSec() - clientTime));
+        }
+    }
+}
+
+void BenchmarkClient::HandleStats(zmq::multipart_t& multipart, BenchmarkRun* run)
+{
+    if (!run || multipart.size() != 3){
+        return;
+    }
+    const zmq::message_t* data = multipart.peek(2);
+    JSONFile json(context_);
+    if (!json.FromString(String(data->data<char>(),(unsigned)data->size()))){
+        return;
+    }
+    const JSONValue& root = json.GetRoot();
+    for (const JSONValue& view : root.Get("views").GetArray()){
+        run->renderedFrames_ += view.Get("rendered").GetUInt();
+    }
+    run->statsInterval_ += root.Get("interval").GetFloat();
+}
+
+void BenchmarkClient::SendView(int viewId, const BenchmarkRun& run, bool resize, unsigned long long now)
+{
+    float angle = (now % ORBIT_TIME) * 360.0f / ORBIT_TIME + viewId * 45.0f;
+
+    ViewMessage view;
+    view.viewId_ = viewId;
+    view.flags_ = resize ? VIEWFLAG_RESOLUTION : 0;
+    view.position_ = Vector3(Cos(angle) * ORBIT_RADIUS,Sin(angle) * ORBIT_RADIUS,ORBIT_HEIGHT);
+    view.direction_ = -view.position_.Normalized();
+    view.up_ = Vector3(0.0f,0.0f,1.0f);
+    view.fov_ = 45.0f;
+    view.width_ = run.width_;
+    view.height_ = run.height_;
+    view.inputSeq_ = ++inputSeq_;
+    view.clientTime_ = now;
+
+    unsigned char data[ViewMessage::SIZE];
+    view.Write(data);
+
+    zmq::multipart_t multipart;
+    multipart.addstr("blender view bin");
+    multipart.addstr("");
+    multipart.addmem(data,ViewMessage::SIZE);
+    multipart.send(pubSocket_);
+}
+
+void BenchmarkClient::SendJSON(const char* subtype, const String& json)
+{
+    zmq::multipart_t multipart;
+    multipart.addstr((String("blender ") + subtype + " json").CString());
+    multipart.addstr("");
+    multipart.addmem(json.CString(),json.Length());
+    multipart.send(pubSocket_);
+}
+
+void BenchmarkClient::WriteResults(JSONValue& dest) const
+{
+    JSONArray results;
+    for (const BenchmarkRun& run : runs_){
+        float duration = Max(run.duration_,M_EPSILON);
+
+        JSONValue result;
+        result.Set("views",run.numViews_);
+        result.Set("width",run.width_);
+        result.Set("height",run.height_);
+        result.Set("update_rate",run.updateRate_);
+        result.Set("rendered_fps",run.statsInterval_ > 0 ? run.renderedFrames_ / run.statsInterval_ : 0.0f);
+        result.Set("delivered_fps",run.deliveredFrames_ / duration);
+        result.Set("bytes_per_sec",(double)run.deliveredBytes_ / duration);
+        // milliseconds
+        result.Set("latency_p50",run.latency_.GetPercentile(0.50f) / 1000.0f);
+        result.Set("latency_p99",run.latency_.GetPercentile(0.99f) / 1000.0f);
+        results.Push(result);
+    }
+    dest = results;
+}
+
+/// Append an axis aligned box (36 vertices, own normals per face).
+static void AddBox(CustomGeometry* geometry, const Vector3& center, const Vector3& halfSize)
+{
+    static const Vector3 normals[] = { Vector3::RIGHT, Vector3::LEFT, Vector3::UP, Vector3::DOWN, Vector3::FORWARD, Vector3::BACK };
+    static const unsigned indices[] = { 0, 1, 2, 0, 2, 3 };
+
+    for (const Vector3& normal : normals){
+        // the two axes spanning the face, v = normal x u keeps the winding clockwise seen from outside
+        Vector3 u = Abs(normal.y_) > 0.5f ? Vector3::RIGHT : Vector3::UP;
+        Vector3 v = normal.CrossProduct(u);
+        Vector3 faceCenter = center + normal * halfSize;
+        Vector3 corners[] = {
+            faceCenter + (-u - v) * halfSize,
+            faceCenter + (u - v) * halfSize,
+            faceCenter + (u + v) * halfSize,
+            faceCenter + (-u + v) * halfSize
+        };
+        for (unsigned index : indices){
+            geometry->DefineVertex(corners[index]);
+            geometry->DefineNormal(normal);
+        }
+    }
+}
+
+Scene* BenchmarkClient::CreateScene(Context* context)
+{
+    Scene* scene = new Scene(context);
+    scene->CreateComponent<Octree>();
+
+    Zone* zone = scene->CreateChild("Zone")->CreateComponent<Zone>();
+    zone->SetBoundingBox(BoundingBox(-1000.0f,1000.0f));
+    zone->SetAmbientColor(Color(0.2f,0.2f,0.2f));
+
+    Node* lightNode = scene->CreateChild("DirectionalLight");
+    lightNode->SetDirection(Vector3(0.6f,-1.0f,0.8f));
+    Light* light = lightNode->CreateComponent<Light>();
+    light->SetLightType(LIGHT_DIRECTIONAL);
+    light->SetCastShadows(true);
+
+    // 16x16 boxes of different heights, one draw call
+    CustomGeometry* geometry = scene->CreateChild("Boxes")->CreateComponent<CustomGeometry>();
+    geometry->SetNumGeometries(1);
+    geometry->BeginGeometry(0,TRIANGLE_LIST);
+    for (int x = -8; x < 8; x++){
+        for (int z = -8; z < 8; z++){
+            float height = 1.0f + (unsigned)(x * 7 + z * 13 + 1000) % 5;
+            AddBox(geometry,Vector3(x * 2.5f,height,z * 2.5f),Vector3(1.0f,height,1.0f));
+        }
+    }
+    geometry->Commit();
+    geometry->SetCastShadows(true);
+
+    return scene;
+}
@@ -0,0 +1,131 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Container/Vector.h>
+#include <Urho3D/Core/Thread.h>
+#include <3rd/cppzmq/zmq.hpp>
+#include <3rd/cppzmq/zmq_addon.hpp>
+
+#include "LatencyStats.h"
+
+#include <atomic>
+
+namespace Urho3D
+{
+class Context;
+class JSONValue;
+class Scene;
+}
+
+using namespace Urho3D;
+
+/// One configuration of the benchmark sweep and what was measured for it.
+struct BenchmarkRun
+{
+    BenchmarkRun()
+        : numViews_(1)
+        , width_(0)
+        , height_(0)
+        , updateRate_(0)
+        , duration_(0)
+        , renderedFrames_(0)
+        , statsInterval_(0)
+        , deliveredFrames_(0)
+        , deliveredBytes_(0)
+    {}
+
+    unsigned numViews_;
+    int width_;
+    int height_;
+    /// view updates per second, each update moves every view
+    float updateRate_;
+
+    /// seconds measured
+    float duration_;
+    /// frames rendered and seconds covered according to the runtime's 'runtime stats'
+    float renderedFrames_;
+    float statsInterval_;
+    /// frames (and their payload bytes) that arrived at the client
+    unsigned deliveredFrames_;
+    unsigned long long deliveredBytes_;
+    /// from sending the view update to receiving the frame that answers it
+    LatencyHistogram latency_;
+};
+
+/// Stand-in for blender to measure the whole pipeline (BlenderNetwork, ViewRenderer, readback,
+/// sending) in one process: orbits the camera of up to 8 views with a fixed rate, acknowledges
+/// the frames it receives and measures throughput and input-to-frame latency per configuration.
+/// Talks to the runtime over inproc sockets, so the runtime has to connect to IN_ENDPOINT and
+/// OUT_ENDPOINT in the context passed to the constructor.
+class BenchmarkClient : public Thread
+{
+public:
+    /// the runtime subscribes here (the client publishes view updates)
+    static const char* IN_ENDPOINT;
+    /// the runtime publishes its frames here
+    static const char* OUT_ENDPOINT;
+    /// scene the benchmark views show, see CreateScene()
+    static const char* SCENE_NAME;
+
+    BenchmarkClient(Context* context,zmq::context_t& ctx);
+    ~BenchmarkClient() override;
+
+    void AddRun(unsigned numViews,int width,int height,float updateRate);
+    /// 1,2,4,8 views x 480p,720p,1080p,4K x 30,60 updates per second
+    void AddDefaultSweep();
+    /// seconds measured per run (after a warm up)
+    inline void SetRunDuration(float duration) { runDuration_ = duration; }
+
+    /// Bind the sockets and start the sweep.
+    bool Start();
+    inline bool IsFinished() const { return finished_; }
+    /// Results of all runs: [{"views","width","height","update_rate","rendered_fps","delivered_fps",
+    /// "bytes_per_sec","latency_p50","latency_p99"}] (latencies in milliseconds). Call once finished.
+    void WriteResults(JSONValue& dest) const;
+
+    void ThreadFunction() override;
+
+    /// Procedural scene (a field of boxes and a light) so the benchmark doesn't depend on exported content.
+    static Scene* CreateScene(Context* context);
+
+private:
+    /// send view updates with the run's rate for duration seconds, results are only counted if measure is set
+    void Execute(BenchmarkRun& run,float duration,bool measure);
+    /// receive for timeout usec
+    void Receive(unsigned long long timeout,BenchmarkRun* run);
+    void HandleFrame(zmq::multipart_t& multipart,BenchmarkRun* run);
+    void HandleStats(zmq::multipart_t& multipart,BenchmarkRun* run);
+    void SendView(int viewId,const BenchmarkRun& run,bool resize,unsigned long long now);
+    void SendJSON(const char* subtype,const String& json);
+
+    Context* context_;
+    zmq::context_t& ctx_;
+    zmq::socket_t pubSocket_;
+    zmq::socket_t subSocket_;
+    Vector<BenchmarkRun> runs_;
+    float runDuration_;
+    unsigned numViewsCreated_;
+    unsigned inputSeq_;
+    std::atomic<bool> finished_;
+};
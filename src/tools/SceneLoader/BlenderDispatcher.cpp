@@ -0,0 +1,50 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "BlenderDispatcher.h"
+
+void BlenderDispatcher::RegisterHandler(const String& topic, const String& subtype, const String& datatype, BlenderMessageHandler* handler)
+{
+    handlers_[BlenderMessage::MakeKey(topic,subtype,datatype)] = handler;
+}
+
+void BlenderDispatcher::UnregisterHandler(const String& topic, const String& subtype, const String& datatype)
+{
+    handlers_.Erase(BlenderMessage::MakeKey(topic,subtype,datatype));
+}
+
+void BlenderDispatcher::Clear()
+{
+    handlers_.Clear();
+}
+
+bool BlenderDispatcher::Dispatch(BlenderMessage& message) const
+{
+    HashMap<StringHash,SharedPtr<BlenderMessageHandler> >::ConstIterator it = handlers_.Find(message.GetKey());
+    if (it == handlers_.End()){
+        return false;
+    }
+    // keep the handler alive even if it unregisters itself
+    SharedPtr<BlenderMessageHandler> handler(it->second_);
+    handler->Invoke(message);
+    return true;
+}
@@ -0,0 +1,76 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Container/HashMap.h>
+#include <Urho3D/Container/Ptr.h>
+
+#include "BlenderMessage.h"
+
+using namespace Urho3D;
+
+/// Handler of one kind of blender message.
+class BlenderMessageHandler : public RefCounted
+{
+public:
+    virtual void Invoke(BlenderMessage& message) = 0;
+};
+
+/// Calls a member function of the receiver.
+template <class T> class BlenderMessageHandlerImpl : public BlenderMessageHandler
+{
+public:
+    typedef void (T::*HandlerFunctionPtr)(BlenderMessage&);
+
+    BlenderMessageHandlerImpl(T* receiver,HandlerFunctionPtr function)
+        : receiver_(receiver)
+        , function_(function)
+    {
+    }
+
+    void Invoke(BlenderMessage& message) override { (receiver_->*function_)(message); }
+
+private:
+    T* receiver_;
+    HandlerFunctionPtr function_;
+};
+
+/// Convenience macro to construct a BlenderMessageHandler that points to a receiver object and its member function.
+#define URHO3D_BLENDER_HANDLER(className, function) (new BlenderMessageHandlerImpl<className>(this, &className::function))
+
+/// Routes blender messages to the handler registered for their (topic, subtype, datatype). The key
+/// is the hash of the topic frame, so a message is routed with one lookup and no string handling.
+class BlenderDispatcher
+{
+public:
+    /// Register a handler, replaces the previous one for the same key. Takes ownership.
+    void RegisterHandler(const String& topic,const String& subtype,const String& datatype,BlenderMessageHandler* handler);
+    void UnregisterHandler(const String& topic,const String& subtype,const String& datatype);
+    void Clear();
+
+    /// Invoke the handler of the message. Returns false if there is none.
+    bool Dispatch(BlenderMessage& message) const;
+
+private:
+    HashMap<StringHash,SharedPtr<BlenderMessageHandler> > handlers_;
+};
@@ -0,0 +1,159 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "BlenderMessage.h"
+
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/IO/MemoryBuffer.h>
+#include <Urho3D/Math/MathDefs.h>
+
+static inline unsigned HashTopic(unsigned hash,const char* str,unsigned length)
+{
+    for (unsigned i=0; i < length; i++){
+        hash = SDBMHash(hash,(unsigned char)str[i]);
+    }
+    return hash;
+}
+
+StringHash BlenderMessage::MakeKey(const String& topic, const String& subtype, const String& datatype)
+{
+    unsigned hash = HashTopic(0,topic.CString(),topic.Length());
+    hash = HashTopic(hash," ",1);
+    hash = HashTopic(hash,subtype.CString(),subtype.Length());
+    hash = HashTopic(hash," ",1);
+    return StringHash(HashTopic(hash,datatype.CString(),datatype.Length()));
+}
+
+BlenderMessage::BlenderMessage(Context* context, zmq::multipart_t& multipart, unsigned long long receiveTime)
+    : context_(context)
+    , receiveTime_(receiveTime)
+    , clientSeparator_(0)
+{
+    separators_[0] = separators_[1] = 0;
+    if (multipart.size() == 3){
+        topicFrame_ = multipart.pop();
+        metaFrame_ = multipart.pop();
+        data_ = multipart.pop();
+    }
+}
+
+bool BlenderMessage::Parse()
+{
+    if (!topicFrame_.size()){
+        URHO3D_LOGERROR("BlenderMessage: WRONG AMOUNT OF MULTIPART_MSGs");
+        return false;
+    }
+
+    // one pass: hash the frame and find the separators
+    const char* topic = topicFrame_.data<char>();
+    unsigned length = (unsigned)topicFrame_.size();
+    unsigned numSeparators = 0;
+    for (unsigned i=0; i < length; i++){
+        if (topic[i] == ':' && !numSeparators && !clientSeparator_){
+            clientSeparator_ = i;
+        }
+        else if (topic[i] == ' '){
+            if (numSeparators == 2){
+                numSeparators++;
+                break;
+            }
+            separators_[numSeparators++] = i;
+        }
+    }
+
+    if (numSeparators != 2){
+        URHO3D_LOGERRORF("BlenderMessage: WRONG TOPIC-FORMAT! %s",String(topic,length).CString());
+        return false;
+    }
+
+    if (clientSeparator_){
+        // "<topic>:<client> <subtype> <datatype>" has the key of "<topic> <subtype> <datatype>"
+        unsigned hash = HashTopic(0,topic,clientSeparator_);
+        key_ = StringHash(HashTopic(hash,topic + separators_[0],length - separators_[0]));
+        clientId_ = StringHash(GetClient());
+    } else {
+        key_ = StringHash(HashTopic(0,topic,length));
+    }
+    return true;
+}
+
+String BlenderMessage::GetTopic() const
+{
+    return String(topicFrame_.data<char>(),clientSeparator_ ? clientSeparator_ : separators_[0]);
+}
+
+String BlenderMessage::GetClient() const
+{
+    if (!clientSeparator_){
+        return String::EMPTY;
+    }
+    return String(topicFrame_.data<char>() + clientSeparator_ + 1,separators_[0] - clientSeparator_ - 1);
+}
+
+String BlenderMessage::GetSubtype() const
+{
+    return String(topicFrame_.data<char>() + separators_[0] + 1,separators_[1] - separators_[0] - 1);
+}
+
+String BlenderMessage::GetDatatype() const
+{
+    return String(topicFrame_.data<char>() + separators_[1] + 1,(unsigned)topicFrame_.size() - separators_[1] - 1);
+}
+
+String BlenderMessage::GetText() const
+{
+    return String(data_.data<char>(),data_.size());
+}
+
+const JSONObject& BlenderMessage::GetJSON()
+{
+    return GetJSONRoot().GetObject();
+}
+
+JSONValue& BlenderMessage::GetJSONRoot()
+{
+    if (!json_){
+        ParseJSON(data_,json_,"data");
+    }
+    return json_->GetRoot();
+}
+
+const JSONObject& BlenderMessage::GetMeta()
+{
+    if (!meta_){
+        ParseJSON(metaFrame_,meta_,"meta");
+    }
+    return meta_->GetRoot().GetObject();
+}
+
+void BlenderMessage::ParseJSON(const zmq::message_t& frame, SharedPtr<JSONFile>& file, const char* what)
+{
+    file = new JSONFile(context_);
+    if (!frame.size()){
+        return;
+    }
+    // parse right from the zeromq frame
+    MemoryBuffer buffer(frame.data(),frame.size());
+    if (!file->Load(buffer)){
+        URHO3D_LOGERRORF("BlenderMessage: could not parse %s of %s",what,String(topicFrame_.data<char>(),topicFrame_.size()).CString());
+    }
+}
@@ -0,0 +1,96 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Container/RefCounted.h>
+#include <Urho3D/Container/Str.h>
+#include <Urho3D/Math/StringHash.h>
+#include <Urho3D/Resource/JSONFile.h>
+#include <3rd/cppzmq/zmq.hpp>
+#include <3rd/cppzmq/zmq_addon.hpp>
+
+using namespace Urho3D;
+
+/// A message from blender (topic, meta and payload frame). Owns the zeromq frames and is passed
+/// through E_BLENDER_MSG by pointer, so handlers read the payload in place. Json payload and meta
+/// are only parsed on first access.
+/// Several blender instances can share a runtime by sending the topic as "<topic>:<client id>"
+/// (e.g. "blender:alice view bin"). The client id is not part of the key, so handlers are
+/// registered once per message type and ask the message for GetClient().
+class BlenderMessage : public RefCounted
+{
+public:
+    /// Takes over the frames of the multipart message.
+    BlenderMessage(Context* context,zmq::multipart_t& multipart,unsigned long long receiveTime=0);
+
+    /// Check the frames and hash the topic. Returns false if the message is malformed.
+    bool Parse();
+
+    /// GetMonotonicUSec() when the network thread received the message
+    inline unsigned long long GetReceiveTime() const { return receiveTime_; }
+    /// hash of the topic frame "<topic> <subtype> <datatype>" without client id, see MakeKey()
+    inline StringHash GetKey() const { return key_; }
+    /// topic without client id
+    String GetTopic() const;
+    String GetSubtype() const;
+    String GetDatatype() const;
+    /// client id of the sender, empty for instances that don't send one
+    String GetClient() const;
+    /// hash of GetClient(), 0 if there is none
+    inline StringHash GetClientId() const { return clientId_; }
+
+    /// key of messages with this topic, subtype and datatype
+    static StringHash MakeKey(const String& topic,const String& subtype,const String& datatype);
+
+    /// payload frame, valid as long as the message lives
+    inline const unsigned char* GetData() const { return data_.data<unsigned char>(); }
+    inline unsigned char* GetData() { return data_.data<unsigned char>(); }
+    inline unsigned GetDataSize() const { return (unsigned)data_.size(); }
+    /// payload as text (copied)
+    String GetText() const;
+
+    /// payload parsed as json (on first call)
+    const JSONObject& GetJSON();
+    /// root of the payload json, to modify it in place
+    JSONValue& GetJSONRoot();
+    /// meta parsed as json (on first call), empty if there is no meta
+    const JSONObject& GetMeta();
+
+private:
+    /// parse the frame into file, or leave it empty on error
+    void ParseJSON(const zmq::message_t& frame,SharedPtr<JSONFile>& file,const char* what);
+
+    Context* context_;
+    zmq::message_t topicFrame_;
+    zmq::message_t metaFrame_;
+    zmq::message_t data_;
+    StringHash key_;
+    StringHash clientId_;
+    unsigned long long receiveTime_;
+    /// positions of the two spaces in the topic frame
+    unsigned separators_[2];
+    /// position of the ':' before the client id, 0 if there is none
+    unsigned clientSeparator_;
+    SharedPtr<JSONFile> json_;
+    SharedPtr<JSONFile> meta_;
+};
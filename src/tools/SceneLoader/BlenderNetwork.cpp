@@ -25,16 +25,19 @@
 #include <zmq.hpp>
 #include <zmq_addon.hpp>
 #include "CustomEvents.h"
+#include "ViewMessage.h"
 #include <Urho3D/Core/CoreEvents.h>
 #include <Urho3D/IO/Log.h>
 #include <Urho3D/Resource/JSONFile.h>
 
+/// keys of the messages that are coalesced per view
+static const StringHash KEY_DATA_CHANGE_JSON = BlenderMessage::MakeKey("blender","data_change","json");
+static const StringHash KEY_VIEW_BIN = BlenderMessage::MakeKey("blender","view","bin");
+
 BlenderNetwork::BlenderNetwork(Context* context) :
-    Object(context)
-    ,running_(false)
-    ,initialized_(false)
+    PubSubNetwork(context)
+    ,numCoalesced_(0)
 {
-    SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(BlenderNetwork, HandleBeginFrame));
 }
 
 void BlenderNetwork::RegisterObject(Context* context)
@@ -52,123 +55,239 @@ void BlenderNetwork::RegisterObject(Context* context)
 //    URHO3D_MIXED_ACCESSOR_ATTRIBUTE("Texture", GetTexture, SetTexture, ResourceRef, ResourceRef(Texture2D::GetTypeStatic()), AM_DEFAULT);
 }
 
-void BlenderNetwork::InitNetwork()
+NetworkConfig BlenderNetwork::GetDefaultConfig()
 {
-    inSocket_ = zmq::socket_t(ctx, zmq::socket_type::sub);
-    inSocket_.connect("tcp://localhost:5560");
-    String topic("blender");
-    inSocket_.setsockopt(ZMQ_SUBSCRIBE, topic.CString(),topic.Length());
-    inSocket_.setsockopt(ZMQ_RCVTIMEO, 50);
-
-    outSocket_ = zmq::socket_t(ctx, zmq::socket_type::pub);
-    outSocket_.connect("tcp://localhost:5559");
-
+    NetworkConfig config;
+    config.inEndpoint_ = "tcp://localhost:5560";
+    config.outEndpoint_ = "tcp://localhost:5559";
+    return config;
 }
 
-void BlenderNetwork::CheckNetwork()
+void BlenderNetwork::InitNetwork()
 {
-    zmq::multipart_t multipart;
-
-    auto ok = multipart.recv(inSocket_);
-    zmq::message_t zmq_msg;
-    if (ok){
-        int mS = multipart.size();
-
-        if (mS != 3){
-            URHO3D_LOGERRORF("BlenderNetwork: WRONG AMOUNT OF MULTIPART_MSGs %i",mS);
-            return;
-        }
+    InitNetwork(GetDefaultConfig());
+}
 
-        auto _topic = multipart.popstr();
-        auto _meta = multipart.popstr();
+void BlenderNetwork::InitNetwork(const NetworkConfig& config, const StringVector& clients)
+{
+    NetworkConfig blenderConfig = config;
+    if (clients.Empty()){
+        // every blender instance, with or without client id
+        PubSubNetwork::InitNetwork(blenderConfig,"blender");
+        return;
+    }
+    // the space ends the topic, so 'blender:a ' doesn't match client 'ab'
+    for (const String& client : clients){
+        blenderConfig.subscriptions_.Push("blender:" + client + " ");
+    }
+    PubSubNetwork::InitNetwork(blenderConfig,"blender ");
+}
 
-        Vector<String> topicSplit = String(_topic.c_str()).Split(' ');
+/// upper bound of messages taken from the socket per frame
+static const unsigned MAX_MESSAGES_PER_FRAME = 1000;
 
-        if (topicSplit.Size() != 3){
-            URHO3D_LOGERRORF("BlenderNetwork: WRONG TOPIC-FORMAT! %s",_topic);
-            return;
+void BlenderNetwork::CheckNetwork()
+{
+    // take everything the network thread received since the last frame. never blocks.
+    zmq::multipart_t* multipart;
+    unsigned long long receiveTime;
+    pendingMessages_.Clear();
+
+    while (pendingMessages_.Size() < MAX_MESSAGES_PER_FRAME && ReceiveMultipart(multipart,&receiveTime)){
+        SharedPtr<BlenderMessage> message(new BlenderMessage(context_,*multipart,receiveTime));
+        delete multipart;
+        if (message->Parse()){
+            QueueMessage(message);
         }
+    }
 
-        auto topic = topicSplit[0];
-        auto subtype = topicSplit[1];
-        auto datatype = topicSplit[2];
-        auto meta = String(_meta.c_str());
-
-        using namespace BlenderConnect;
-        VariantMap map;
-        map[P_TOPIC]=topic;
-        map[P_SUBTYPE]=subtype;
-        map[P_DATATYPE]=datatype;
-
-        if (meta!=""){
-            JSONFile metaJson(context_);
-            metaJson.FromString(meta);
-            auto root = metaJson.GetRoot().GetObject();
-            map[P_META]=MakeCustomValue(root);
+    using namespace BlenderConnect;
+    for (SharedPtr<BlenderMessage>& message : pendingMessages_){
+        if (dispatcher_.Dispatch(*message)){
+            continue;
         }
+        VariantMap& map = GetEventDataMap();
+        map[P_TOPIC]=message->GetTopic();
+        map[P_SUBTYPE]=message->GetSubtype();
+        map[P_DATATYPE]=message->GetDatatype();
+        map[P_CLIENT]=message->GetClient();
+        map[P_MESSAGE]=message.Get();
+        SendEvent(E_BLENDER_MSG,map);
+    }
+    pendingMessages_.Clear();
+}
 
-        zmq_msg = multipart.pop();
-        if (datatype == "text"){
-            std::string data(zmq_msg.data<char>(),zmq_msg.size());
-            map[P_DATA] = String(data.c_str());
-            SendEvent(E_BLENDER_MSG,map);
+void BlenderNetwork::QueueMessage(BlenderMessage* message)
+{
+    StringHash key = message->GetKey();
+
+    // view updates are idempotent: only the newest state per view has to be applied. keys of
+    // older updates of the same view the new one doesn't have are merged into it (e.g. a
+    // resolution change) and the older ones are dropped. everything else keeps its order.
+    if (key == KEY_DATA_CHANGE_JSON){
+        JSONValue& data = message->GetJSONRoot();
+        if (data.Contains("view_id")){
+            int viewId = data.Get("view_id").GetInt();
+            for (unsigned i = 0; i < pendingMessages_.Size(); i++){
+                BlenderMessage* older = pendingMessages_[i];
+                if (older->GetKey() != KEY_DATA_CHANGE_JSON || older->GetClientId() != message->GetClientId()){
+                    continue;
+                }
+                JSONValue& olderData = older->GetJSONRoot();
+                if (!olderData.Contains("view_id") || olderData.Get("view_id").GetInt() != viewId){
+                    continue;
+                }
+                for (ConstJSONObjectIterator it = olderData.Begin(); it != olderData.End(); ++it){
+                    if (!data.Contains(it->first_)){
+                        data.Set(it->first_,it->second_);
+                    }
+                }
+                pendingMessages_.Erase(i);
+                numCoalesced_++;
+                break;
+            }
         }
-        else if (datatype == "json"){
-            std::string data(zmq_msg.data<char>(),zmq_msg.size());
-
-            JSONFile jsonFile(context_);
-            jsonFile.FromString(Urho3D::String(data.c_str()));
-            auto root = jsonFile.GetRoot().GetObject();
-           // CustomVariantValueImpl<JSONFile> val(jsonFile);
-            if (root.Contains("view_matrix")){
-                auto v = root["view_matrix"];
-                int a=0;
+    }
+    // same for binary view updates, they always carry the full camera state
+    else if (key == KEY_VIEW_BIN){
+        int viewId = ViewMessage::PeekViewId(message->GetData(),message->GetDataSize());
+        for (unsigned i = 0; viewId != -1 && i < pendingMessages_.Size(); i++){
+            BlenderMessage* older = pendingMessages_[i];
+            if (older->GetKey() != KEY_VIEW_BIN || older->GetClientId() != message->GetClientId()
+                    || ViewMessage::PeekViewId(older->GetData(),older->GetDataSize()) != viewId){
+                continue;
             }
-            map[P_DATA]=MakeCustomValue(root);
-        } else {
-            URHO3D_LOGERRORF("BlenderNetwork: unsupported datatype:%s",datatype.CString());
+            ViewMessage olderView;
+            ViewMessage view;
+            olderView.Read(older->GetData(),older->GetDataSize());
+            view.Read(message->GetData(),message->GetDataSize());
+            view.Merge(olderView);
+            // same version and size, written back in place
+            view.Write(message->GetData());
+            pendingMessages_.Erase(i);
+            numCoalesced_++;
+            break;
         }
-        SendEvent(E_BLENDER_MSG,map);
+    }
+    pendingMessages_.Push(SharedPtr<BlenderMessage>(message));
+}
 
+void BlenderNetwork::Close()
+{
+    dispatcher_.Clear();
+    PubSubNetwork::Close();
+    shmRings_.Clear();
+}
 
+void BlenderNetwork::Send(const String& topic,const String& subtype, void *buffer,int length, const String& meta)
+{
+    zmq::multipart_t* multipart = new zmq::multipart_t();
+    multipart->addstr((topic+" "+subtype+" bin").CString());
+    multipart->addstr(meta.CString());
+    multipart->add(zmq::message_t(buffer,length));
+    SendMultipart(multipart);
+}
 
-      //  URHO3D_LOGINFOF("NETWORK:%s\n",recv_msg.c_str());
-        //URHO3D_LOGINFO("---NET--");
+bool BlenderNetwork::SetFrameTransport(StringHash client, FrameTransport transport)
+{
+    if (transport == GetFrameTransport(client)){
+        return true;
+    }
+    if (transport == TRANSPORT_SHM){
+        SharedPtr<SharedMemoryRing> ring(new SharedMemoryRing());
+        HashMap<StringHash,unsigned>::ConstIterator slots = numFrameSlots_.Find(client);
+        // start with room for a 1080p frame, the ring grows if needed
+        if (!ring->Create(slots != numFrameSlots_.End() ? slots->second_ : 4,1920*1080*4)){
+            URHO3D_LOGWARNING("BlenderNetwork: shared memory not available, frames are sent via tcp");
+            return false;
+        }
+        shmRings_[client] = ring;
     } else {
-       //URHO3D_LOGINFO("NETWORK: no result");
+        // the destructor unlinks the ring
+        shmRings_.Erase(client);
     }
+    return true;
 }
 
-void BlenderNetwork::HandleBeginFrame(StringHash eventType, VariantMap &eventData)
+FrameTransport BlenderNetwork::GetFrameTransport(StringHash client) const
 {
-    CheckNetwork();
+    return shmRings_.Contains(client) ? TRANSPORT_SHM : TRANSPORT_TCP;
 }
 
-void BlenderNetwork::Close()
+void BlenderNetwork::ReserveFrameSlots(StringHash client, unsigned numSlots)
+{
+    unsigned& numFrameSlots = numFrameSlots_[client];
+    numFrameSlots = Max(numFrameSlots,numSlots);
+    HashMap<StringHash,SharedPtr<SharedMemoryRing> >::Iterator it = shmRings_.Find(client);
+    if (it != shmRings_.End() && !it->second_->Reserve(numFrameSlots)){
+        URHO3D_LOGWARNING("BlenderNetwork: could not grow the shared memory, frames are sent via tcp");
+        shmRings_.Erase(it);
+    }
+}
+
+bool BlenderNetwork::SendFrame(StringHash client, const String& topic, const String& subtype, FrameBuffer* buffer, const String& meta)
 {
-    inSocket_.close();
-    outSocket_.close();
-    ctx.close();
+    return SendFrame(client,topic,subtype,buffer,(const unsigned char*)meta.CString(),meta.Length());
 }
 
-void BlenderNetwork::Send(const String& topic,const String& subtype, void *buffer,int length, const String& meta)
+bool BlenderNetwork::SendFrame(StringHash client, const String& topic, const String& subtype, FrameBuffer* buffer, const unsigned char* meta, unsigned metaSize)
 {
-    zmq::multipart_t multipart;
-    multipart.addstr((topic+" "+subtype+" bin").CString());
-    multipart.addstr(meta.CString());
-    multipart.add(zmq::message_t(buffer,length));
-    multipart.send(outSocket_);
+    HashMap<StringHash,SharedPtr<SharedMemoryRing> >::Iterator it = shmRings_.Find(client);
+    if (it != shmRings_.End()){
+        SharedMemoryRing* shmRing = it->second_;
+        unsigned slot;
+        unsigned long long sequence;
+        if (shmRing->Write(buffer->data_,buffer->size_,slot,sequence)){
+            String control = "{\"name\":\"" + shmRing->GetName() + "\",\"slot\":" + String(slot)
+                    + ",\"size\":" + String(buffer->size_) + ",\"seq\":" + String(sequence) + "}";
+            // the pixels don't go through zeromq, count them anyway
+            bytesSent_ += buffer->size_;
+            buffer->pool_->Release(buffer);
+
+            zmq::multipart_t* multipart = new zmq::multipart_t();
+            multipart->addstr((topic+" "+subtype+" shm").CString());
+            multipart->addmem(meta,metaSize);
+            multipart->addstr(control.CString());
+            if (!SendMultipart(multipart)){
+                // blender never hears of the slot
+                shmRing->Release(slot,sequence);
+                return false;
+            }
+            return true;
+        }
+        if (!shmRing->IsCreated()){
+            URHO3D_LOGWARNING("BlenderNetwork: writing to shared memory failed, falling back to tcp");
+            shmRings_.Erase(it);
+        }
+        // otherwise blender did not read any of the slots yet, only this frame goes via tcp
+    }
+
+    // zero-copy: the buffer is released by zeromq after the network thread sent it
+    zmq::multipart_t* multipart = new zmq::multipart_t();
+    multipart->addstr((topic+" "+subtype+" bin").CString());
+    multipart->addmem(meta,metaSize);
+    multipart->add(zmq::message_t(buffer->data_,buffer->size_,FrameBufferPool::ZMQFree,buffer));
+    return SendMultipart(multipart);
 }
 
 void BlenderNetwork::Send(const String& topic,const String& subtype, const String& txtData, const String& meta)
 {
-    zmq::multipart_t multipart;
+    zmq::multipart_t* multipart = new zmq::multipart_t();
 //    multipart.push(zmq::message_t(topic.CString(),topic.Length()));
 //    multipart.push(zmq::message_t(txtData.CString(),topic.Length()));
-    multipart.addstr((topic+" "+subtype+" text").CString());
-    multipart.addstr(meta.CString());
-    multipart.addstr(txtData.CString());
-    multipart.send(outSocket_);
+    multipart->addstr((topic+" "+subtype+" text").CString());
+    multipart->addstr(meta.CString());
+    multipart->addstr(txtData.CString());
+    SendMultipart(multipart);
+}
+
+void BlenderNetwork::SendJSON(const String& topic,const String& subtype, const String& json, const String& meta)
+{
+    zmq::multipart_t* multipart = new zmq::multipart_t();
+    multipart->addstr((topic+" "+subtype+" json").CString());
+    multipart->addstr(meta.CString());
+    multipart->addmem(json.CString(),json.Length());
+    SendMultipart(multipart);
 }
 
 //void BlenderNetwork::CreateScreenshot()
@@ -26,16 +26,30 @@
 #include <Urho3D/Scene/LogicComponent.h>
 #include <Urho3D/Graphics/AnimationController.h>
 #include <3rd/cppzmq/zmq.hpp>
+#include <3rd/cppzmq/zmq_addon.hpp>
+#include <commonObjects/PubSubNetwork.h>
+
+#include "BlenderMessage.h"
+#include "BlenderDispatcher.h"
+#include "FrameBufferPool.h"
+#include "SharedMemoryRing.h"
 
 using namespace Urho3D;
 
 
-// TODO: Rebuild to be base on PubSubNetwork
+/// How the pixel data of frames gets to blender.
+enum FrameTransport {
+    /// the frame is part of the zeromq message
+    TRANSPORT_TCP,
+    /// the frame is written to a SharedMemoryRing, zeromq only carries the slot
+    TRANSPORT_SHM
+};
 
-/// Network component, responsible for physical movement according to controls, as well as animation.
-class BlenderNetwork : public Object
+/// Connection to blender. Messages are routed to the handlers registered for their topic, subtype
+/// and datatype; messages without handler are sent as E_BLENDER_MSG.
+class BlenderNetwork : public PubSubNetwork
 {
-    URHO3D_OBJECT(BlenderNetwork, Object);
+    URHO3D_OBJECT(BlenderNetwork, PubSubNetwork);
 
 public:
     /// Construct.
@@ -44,18 +58,47 @@ public:
     /// Register object factory and attributes.
     static void RegisterObject(Context* context);
 
+    /// Connect with the default endpoints (tcp://localhost:5560 in, 5559 out).
     void InitNetwork();
-    void CheckNetwork();
-    void Close();
-    /// Handle begin frame event.
-    void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
+    /// Connect with the given endpoints. The view endpoint carries the same messages as the in endpoint
+    /// ('blender[:client] view bin' camera updates), they are coalesced per client and view.
+    /// Subscribes to all blender instances, or only to those without client id and the given clients.
+    void InitNetwork(const NetworkConfig& config,const StringVector& clients=StringVector());
+    /// NetworkConfig with the default endpoints
+    static NetworkConfig GetDefaultConfig();
+    void CheckNetwork() override;
+    void Close() override;
+    /// Register the handler for messages with this topic, subtype and datatype. Takes ownership.
+    inline void RegisterHandler(const String& topic,const String& subtype,const String& datatype,BlenderMessageHandler* handler) { dispatcher_.RegisterHandler(topic,subtype,datatype,handler); }
+    inline void UnregisterHandler(const String& topic,const String& subtype,const String& datatype) { dispatcher_.UnregisterHandler(topic,subtype,datatype); }
     void Send(const String& topic,const String& subtype,const String& txtData, const String& meta="");
     void Send(const String& topic,const String& subtype,void* buffer,int length, const String& meta="");
+    /// Send a frame for the client (see BlenderMessage::GetClientId()) with its transport, without copying it. Takes
+    /// ownership, the buffer goes back to its pool once zeromq is done with it. Returns false if the frame was dropped
+    /// because the send queue is full.
+    bool SendFrame(StringHash client,const String& topic,const String& subtype,FrameBuffer* buffer, const String& meta="");
+    /// Send json (datatype 'json').
+    void SendJSON(const String& topic,const String& subtype,const String& json, const String& meta="");
+    /// Same as above with binary meta.
+    bool SendFrame(StringHash client,const String& topic,const String& subtype,FrameBuffer* buffer, const unsigned char* meta,unsigned metaSize);
+    /// amount of view updates that were dropped because a newer one arrived in the same frame
+    inline unsigned GetNumCoalesced() const { return numCoalesced_; }
+    /// Switch the transport for the frames of a client, every client has its own shared memory ring. Returns false
+    /// (and stays on tcp) if shared memory is not available.
+    bool SetFrameTransport(StringHash client,FrameTransport transport);
+    FrameTransport GetFrameTransport(StringHash client) const;
+    /// Shared memory slots needed for all frames of the client that may be in flight at the same time. Only grows.
+    void ReserveFrameSlots(StringHash client,unsigned numSlots);
 private:
-    bool running_;
-    zmq::socket_t  inSocket_;
-    zmq::socket_t  outSocket_;
-    bool initialized_;
-    zmq::context_t ctx;
+    /// add the message to this frame's messages, merging it with an older update of the same view
+    void QueueMessage(BlenderMessage* message);
+
+    BlenderDispatcher dispatcher_;
+    /// messages received this frame, in order
+    Vector<SharedPtr<BlenderMessage> > pendingMessages_;
+    unsigned numCoalesced_;
+    /// rings of the clients that use TRANSPORT_SHM
+    HashMap<StringHash,SharedPtr<SharedMemoryRing> > shmRings_;
+    HashMap<StringHash,unsigned> numFrameSlots_;
 
 };
@@ -0,0 +1,68 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "DynamicResolution.h"
+
+#include <Urho3D/Math/MathDefs.h>
+
+using namespace Urho3D;
+
+/// weight of a new sample in the moving average
+static const float SAMPLE_WEIGHT = 0.3f;
+/// scales are multiples of this, to avoid resizing the rendertarget on every frame
+static const float SCALE_STEP = 1.0f / 16.0f;
+
+DynamicResolution::DynamicResolution()
+    : targetFrameTime_(1.0f / 60.0f)
+    , minScale_(0.25f)
+    , fullResCost_(0)
+    , scale_(1.0f)
+{
+}
+
+void DynamicResolution::SetParameters(float targetFrameTime, float minScale)
+{
+    targetFrameTime_ = Max(targetFrameTime,0.001f);
+    minScale_ = Clamp(minScale,SCALE_STEP,1.0f);
+}
+
+void DynamicResolution::AddSample(float frameTime, float scale)
+{
+    float cost = frameTime / (scale * scale);
+    fullResCost_ = fullResCost_ > 0 ? Lerp(fullResCost_,cost,SAMPLE_WEIGHT) : cost;
+}
+
+float DynamicResolution::UpdateScale()
+{
+    if (fullResCost_ <= 0){
+        return 1.0f;
+    }
+
+    float scale = Clamp(sqrtf(targetFrameTime_ / fullResCost_),minScale_,1.0f);
+    scale = Clamp(floorf(scale / SCALE_STEP) * SCALE_STEP,minScale_,1.0f);
+
+    // go down right away if too slow, but only go up again with some margin to not flip between two scales
+    if (scale < scale_ || scale - scale_ >= 2 * SCALE_STEP){
+        scale_ = scale;
+    }
+    return scale_;
+}
@@ -0,0 +1,48 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+/// Picks the render scale of a view while it is navigated, so that the gpu time of a frame
+/// stays around a target time. The gpu time is assumed to grow with the pixel count, so every
+/// sample is normalized to full resolution before it is averaged. Cpu submit time doesn't
+/// depend on the scale and must not be fed in, the scale would swing between the extremes.
+class DynamicResolution
+{
+public:
+    DynamicResolution();
+
+    /// targetFrameTime in seconds, minScale in (0,1]
+    void SetParameters(float targetFrameTime,float minScale);
+    /// Feed the gpu time (seconds) of a frame rendered with the given scale.
+    void AddSample(float frameTime,float scale);
+    /// Scale for the next interactive frame.
+    float UpdateScale();
+
+private:
+    float targetFrameTime_;
+    float minScale_;
+    /// smoothed cost of a full resolution frame
+    float fullResCost_;
+    /// last returned scale (for hysteresis)
+    float scale_;
+};
@@ -0,0 +1,110 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "FrameBufferPool.h"
+
+FrameBufferPool::FrameBufferPool(unsigned maxFree)
+    : maxFree_(maxFree)
+    , numAcquired_(0)
+    , destroyed_(false)
+{
+}
+
+FrameBufferPool::~FrameBufferPool()
+{
+    for (FrameBuffer* buffer : free_){
+        DeleteBuffer(buffer);
+    }
+}
+
+FrameBuffer* FrameBufferPool::Acquire(unsigned size)
+{
+    MutexLock lock(mutex_);
+
+    FrameBuffer* result = nullptr;
+    for (unsigned i=0; i < free_.Size(); i++){
+        if (free_[i]->capacity_ >= size){
+            result = free_[i];
+            free_.Erase(i);
+            break;
+        }
+    }
+
+    if (!result){
+        // nothing fits (e.g. the view got bigger) => drop the oldest idle buffer and allocate a new one
+        if (!free_.Empty()){
+            DeleteBuffer(free_.Front());
+            free_.Erase(0);
+        }
+        result = new FrameBuffer();
+        result->data_ = new unsigned char[size];
+        result->capacity_ = size;
+        result->pool_ = this;
+    }
+
+    result->size_ = size;
+    numAcquired_++;
+    return result;
+}
+
+void FrameBufferPool::Release(FrameBuffer* buffer)
+{
+    bool deletePool = false;
+    {
+        MutexLock lock(mutex_);
+        numAcquired_--;
+        if (destroyed_ || free_.Size() >= maxFree_){
+            DeleteBuffer(buffer);
+        } else {
+            free_.Push(buffer);
+        }
+        deletePool = destroyed_ && numAcquired_ == 0;
+    }
+    if (deletePool){
+        delete this;
+    }
+}
+
+void FrameBufferPool::Destroy()
+{
+    bool deletePool = false;
+    {
+        MutexLock lock(mutex_);
+        destroyed_ = true;
+        deletePool = numAcquired_ == 0;
+    }
+    if (deletePool){
+        delete this;
+    }
+}
+
+void FrameBufferPool::ZMQFree(void* data, void* hint)
+{
+    FrameBuffer* buffer = static_cast<FrameBuffer*>(hint);
+    buffer->pool_->Release(buffer);
+}
+
+void FrameBufferPool::DeleteBuffer(FrameBuffer* buffer)
+{
+    delete[] buffer->data_;
+    delete buffer;
+}
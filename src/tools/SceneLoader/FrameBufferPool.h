@@ -0,0 +1,71 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Container/Vector.h>
+#include <Urho3D/Core/Mutex.h>
+
+using namespace Urho3D;
+
+class FrameBufferPool;
+
+/// Pixel buffer handed out by a FrameBufferPool.
+struct FrameBuffer {
+    unsigned char* data_;
+    /// bytes in use
+    unsigned size_;
+    /// allocated bytes
+    unsigned capacity_;
+    FrameBufferPool* pool_;
+};
+
+/// Recycles the buffers frames are read into, so the pixel data is written once and handed to
+/// zeromq without copy. The buffer comes back via ZMQFree once zeromq sent it, which happens
+/// on zeromq's io-thread, therefore Acquire/Release are thread-safe.
+class FrameBufferPool
+{
+public:
+    explicit FrameBufferPool(unsigned maxFree=4);
+
+    /// Get a buffer with room for at least size bytes (size_ is set to size).
+    FrameBuffer* Acquire(unsigned size);
+    /// Give a buffer back to the pool.
+    void Release(FrameBuffer* buffer);
+    /// Destroy the pool. If buffers are still in flight the pool is deleted with the last of them.
+    void Destroy();
+
+    /// Free-function for zmq::message_t. hint has to be the FrameBuffer.
+    static void ZMQFree(void* data,void* hint);
+
+private:
+    ~FrameBufferPool();
+    void DeleteBuffer(FrameBuffer* buffer);
+
+    Mutex mutex_;
+    PODVector<FrameBuffer*> free_;
+    /// maximum amount of idle buffers kept around
+    unsigned maxFree_;
+    /// buffers currently handed out
+    unsigned numAcquired_;
+    bool destroyed_;
+};
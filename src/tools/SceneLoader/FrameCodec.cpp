@@ -0,0 +1,143 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "FrameCodec.h"
+
+#include <Urho3D/Math/MathDefs.h>
+
+#include <LZ4/lz4.h>
+
+#include <cstring>
+
+static const char* codecNames[] = {
+    "raw",
+    "lz4",
+    "delta-lz4",
+    nullptr
+};
+
+const char* FrameCodec::ToString(FramePixelFormat format)
+{
+    return format == FORMAT_YUVA420 ? "yuva420" : "rgba8";
+}
+
+unsigned FrameCodec::GetYUVA420Size(int width, int height)
+{
+    unsigned chromaSize = ((width + 1) / 2) * ((height + 1) / 2);
+    return width * height * 2 + chromaSize * 2;
+}
+
+unsigned FrameCodec::ConvertToYUVA420(const unsigned char* rgba, int width, int height, unsigned char* dest)
+{
+    int chromaWidth = (width + 1) / 2;
+    int chromaHeight = (height + 1) / 2;
+    unsigned char* yPlane = dest;
+    unsigned char* uPlane = yPlane + width * height;
+    unsigned char* vPlane = uPlane + chromaWidth * chromaHeight;
+    unsigned char* aPlane = vPlane + chromaWidth * chromaHeight;
+    int stride = width * 4;
+
+    for (int cy=0; cy < chromaHeight; cy++){
+        for (int cx=0; cx < chromaWidth; cx++){
+            int sumR = 0, sumG = 0, sumB = 0, count = 0;
+            for (int y = cy * 2; y < Min(cy * 2 + 2,height); y++){
+                for (int x = cx * 2; x < Min(cx * 2 + 2,width); x++){
+                    const unsigned char* p = rgba + y * stride + x * 4;
+                    int r = p[0], g = p[1], b = p[2];
+                    yPlane[y * width + x] = (unsigned char)((77 * r + 150 * g + 29 * b) >> 8);
+                    aPlane[y * width + x] = p[3];
+                    sumR += r;
+                    sumG += g;
+                    sumB += b;
+                    count++;
+                }
+            }
+            int r = sumR / count, g = sumG / count, b = sumB / count;
+            uPlane[cy * chromaWidth + cx] = (unsigned char)Clamp(((-43 * r - 85 * g + 128 * b) >> 8) + 128,0,255);
+            vPlane[cy * chromaWidth + cx] = (unsigned char)Clamp(((128 * r - 107 * g - 21 * b) >> 8) + 128,0,255);
+        }
+    }
+    return GetYUVA420Size(width,height);
+}
+
+FrameCodecType FrameCodec::FromString(const String& name)
+{
+    for (unsigned i=0; i < MAX_FRAME_CODECS; i++){
+        if (name == codecNames[i]){
+            return (FrameCodecType)i;
+        }
+    }
+    return CODEC_RAW;
+}
+
+const char* FrameCodec::ToString(FrameCodecType codec)
+{
+    return codecNames[codec < MAX_FRAME_CODECS ? codec : CODEC_RAW];
+}
+
+unsigned FrameCodec::GetMaxEncodedSize(FrameCodecType codec, unsigned size)
+{
+    if (codec == CODEC_RAW){
+        return size;
+    }
+    return (unsigned)LZ4_compressBound(size);
+}
+
+unsigned FrameCodec::Encode(FrameCodecType codec, const unsigned char* src, unsigned size, unsigned char* dest)
+{
+    switch (codec){
+        case CODEC_RAW:
+            memcpy(dest,src,size);
+            return size;
+
+        case CODEC_DELTA_LZ4:
+            DeltaFilter(src,size);
+            src = filtered_.Buffer();
+            // fallthrough
+        case CODEC_LZ4: {
+            int result = LZ4_compress_default((const char*)src,(char*)dest,size,LZ4_compressBound(size));
+            return result > 0 ? (unsigned)result : 0;
+        }
+
+        default:
+            return 0;
+    }
+}
+
+void FrameCodec::DeltaFilter(const unsigned char* src, unsigned size)
+{
+    filtered_.Resize(size);
+
+    unsigned numPixels = size / 4;
+    unsigned char* dest = filtered_.Buffer();
+    for (unsigned channel=0; channel < 4; channel++){
+        unsigned char last = 0;
+        const unsigned char* in = src + channel;
+        for (unsigned i=0; i < numPixels; i++){
+            *dest++ = *in - last;
+            last = *in;
+            in += 4;
+        }
+    }
+    // trailing bytes that are no full pixel
+    memcpy(dest,src + numPixels * 4,size - numPixels * 4);
+}
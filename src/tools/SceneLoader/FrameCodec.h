@@ -0,0 +1,72 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Container/Str.h>
+#include <Urho3D/Container/Vector.h>
+
+using namespace Urho3D;
+
+/// Lossless compression of the frame payload.
+enum FrameCodecType {
+    /// uncompressed rgba
+    CODEC_RAW = 0,
+    /// lz4 (fast mode)
+    CODEC_LZ4,
+    /// rgba split into byte planes, each plane delta coded, then lz4
+    CODEC_DELTA_LZ4,
+    MAX_FRAME_CODECS
+};
+
+/// Pixel layout of the frame payload.
+enum FramePixelFormat {
+    /// interleaved 8 bit rgba
+    FORMAT_RGBA8 = 0,
+    /// planar full-res luma, quarter-res chroma (bt.601), full-res alpha. lossy, 2.5 instead of 4 bytes per pixel
+    FORMAT_YUVA420,
+};
+
+/// Encodes frame payloads (full frames or packed tiles of 4 byte pixels) before they get sent.
+class FrameCodec
+{
+public:
+    /// Codec for the name used in the blender protocol. Unknown names map to CODEC_RAW.
+    static FrameCodecType FromString(const String& name);
+    static const char* ToString(FrameCodecType codec);
+    /// Worst case size of the encoded data.
+    static unsigned GetMaxEncodedSize(FrameCodecType codec,unsigned size);
+    static const char* ToString(FramePixelFormat format);
+    /// Size of a width x height yuva420 image.
+    static unsigned GetYUVA420Size(int width,int height);
+    /// Convert an rgba image to yuva420 (Y, U, V and A planes one after another). Returns the size written to dest.
+    static unsigned ConvertToYUVA420(const unsigned char* rgba,int width,int height,unsigned char* dest);
+
+    /// Encode size bytes from src into dest (GetMaxEncodedSize bytes). Returns the encoded size or 0 on failure.
+    unsigned Encode(FrameCodecType codec,const unsigned char* src,unsigned size,unsigned char* dest);
+
+private:
+    /// Reorder rgba into planes and replace every byte by its difference to the previous one of its plane.
+    void DeltaFilter(const unsigned char* src,unsigned size);
+
+    PODVector<unsigned char> filtered_;
+};
@@ -0,0 +1,216 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "FrameHeader.h"
+
+#include <Urho3D/Resource/JSONValue.h>
+
+#include <cstring>
+
+FrameHeader::FrameHeader()
+    : format_(FORMAT_RGBA8)
+    , codec_(CODEC_RAW)
+    , flags_(0)
+    , rawSize_(0)
+    , tileSize_(0)
+    , sendTimestamp_(0)
+{
+}
+
+void FrameHeader::Reset(const FrameInfo& info)
+{
+    info_ = info;
+    format_ = FORMAT_RGBA8;
+    codec_ = CODEC_RAW;
+    flags_ = info.scale_ < 1.0f ? FRAMEFLAG_SCALED : 0;
+    rawSize_ = info.dataSize_;
+    tileSize_ = 0;
+    tileRuns_.Clear();
+    sendTimestamp_ = 0;
+}
+
+void FrameHeader::SetTiles(unsigned tileSize, const PODVector<unsigned>& tiles)
+{
+    tileSize_ = tileSize;
+    tileRuns_.Clear();
+    for (unsigned i=0; i < tiles.Size(); i++){
+        unsigned first = tiles[i];
+        unsigned count = 1;
+        while (i+1 < tiles.Size() && tiles[i+1] == first + count){
+            count++;
+            i++;
+        }
+        tileRuns_.Push(first);
+        tileRuns_.Push(count);
+    }
+}
+
+template <class T> static inline unsigned char* Put(unsigned char* dest,T value)
+{
+    // the runtime only runs on little endian hosts, so this is the wire format as is
+    memcpy(dest,&value,sizeof(T));
+    return dest + sizeof(T);
+}
+
+void FrameHeader::WriteBinary(PODVector<unsigned char>& dest) const
+{
+    unsigned size = FIXED_SIZE + tileRuns_.Size() * 4;
+    dest.Resize(size);
+
+    unsigned char* p = dest.Buffer();
+    memcpy(p,"U3DF",4);
+    p += 4;
+    p = Put<unsigned short>(p,VERSION);
+    p = Put<unsigned short>(p,FIXED_SIZE);
+    p = Put<unsigned>(p,info_.sequence_);
+    p = Put<unsigned>(p,info_.width_);
+    p = Put<unsigned>(p,info_.height_);
+    p = Put<unsigned>(p,info_.width_ * 4);
+    p = Put<unsigned char>(p,format_);
+    p = Put<unsigned char>(p,codec_);
+    p = Put<unsigned short>(p,flags_);
+    p = Put<float>(p,info_.fov_);
+    p = Put<float>(p,info_.initialFov_);
+    p = Put<unsigned>(p,info_.viewWidth_);
+    p = Put<unsigned>(p,info_.viewHeight_);
+    p = Put<unsigned>(p,rawSize_);
+    p = Put<unsigned long long>(p,info_.renderTimestamp_);
+    p = Put<unsigned long long>(p,sendTimestamp_);
+    p = Put<unsigned short>(p,tileSize_);
+    p = Put<unsigned short>(p,0);
+    p = Put<unsigned>(p,tileRuns_.Size() / 2);
+    p = Put<unsigned long long>(p,info_.trace_.clientTime_);
+    p = Put<unsigned>(p,info_.trace_.inputSeq_);
+    p = Put<unsigned>(p,0);
+    if (!tileRuns_.Empty()){
+        memcpy(p,tileRuns_.Buffer(),tileRuns_.Size() * 4);
+    }
+}
+
+template <class T> static inline const unsigned char* Get(const unsigned char* src,T& value)
+{
+    memcpy(&value,src,sizeof(T));
+    return src + sizeof(T);
+}
+
+bool FrameHeader::ReadBinary(const unsigned char* data, unsigned size)
+{
+    if (size < 8 || memcmp(data,"U3DF",4) != 0){
+        return false;
+    }
+    unsigned short version;
+    unsigned short fixedSize;
+    const unsigned char* p = Get(data + 4,version);
+    p = Get(p,fixedSize);
+    // version 1 ends after the number of tile runs
+    if (fixedSize > size || fixedSize < (version >= 2 ? FIXED_SIZE : 72)){
+        return false;
+    }
+
+    Reset(FrameInfo());
+    unsigned stride;
+    unsigned char format;
+    unsigned char codec;
+    unsigned short flags;
+    unsigned short tileSize;
+    unsigned short reserved;
+    unsigned numTileRuns;
+    p = Get(p,info_.sequence_);
+    p = Get(p,info_.width_);
+    p = Get(p,info_.height_);
+    p = Get(p,stride);
+    p = Get(p,format);
+    p = Get(p,codec);
+    p = Get(p,flags);
+    p = Get(p,info_.fov_);
+    p = Get(p,info_.initialFov_);
+    p = Get(p,info_.viewWidth_);
+    p = Get(p,info_.viewHeight_);
+    p = Get(p,rawSize_);
+    p = Get(p,info_.renderTimestamp_);
+    p = Get(p,sendTimestamp_);
+    p = Get(p,tileSize);
+    p = Get(p,reserved);
+    p = Get(p,numTileRuns);
+    if (version >= 2){
+        p = Get(p,info_.trace_.clientTime_);
+        p = Get(p,info_.trace_.inputSeq_);
+    }
+    format_ = (FramePixelFormat)format;
+    codec_ = (FrameCodecType)codec;
+    flags_ = flags;
+    tileSize_ = tileSize;
+
+    if (fixedSize + numTileRuns * 8 > size){
+        return false;
+    }
+    tileRuns_.Resize(numTileRuns * 2);
+    if (numTileRuns){
+        memcpy(tileRuns_.Buffer(),data + fixedSize,numTileRuns * 8);
+    }
+    return true;
+}
+
+void FrameHeader::WriteJSON(JSONValue& meta) const
+{
+    meta.Clear();
+
+    JSONObject json;
+    json["width"]=info_.width_;
+    json["height"]=info_.height_;
+    meta.Set("resolution",json);
+    if (flags_ & FRAMEFLAG_SCALED){
+        // rendered smaller, blender scales it up to the view size
+        JSONObject viewSize;
+        viewSize["width"]=info_.viewWidth_;
+        viewSize["height"]=info_.viewHeight_;
+        meta.Set("view_resolution",viewSize);
+        meta.Set("scale",info_.scale_);
+    }
+    meta.Set("fov",info_.fov_);
+    meta.Set("initial-fov",info_.initialFov_);
+    meta.Set("seq",info_.sequence_);
+    if (info_.trace_.IsValid()){
+        // lets blender measure the round trip of its input
+        meta.Set("input_seq",info_.trace_.inputSeq_);
+        meta.Set("client_time",(double)info_.trace_.clientTime_);
+    }
+    meta.Set("format",FrameCodec::ToString(format_));
+    meta.Set("quality",(flags_ & FRAMEFLAG_PREVIEW) ? "preview" : "final");
+
+    if (flags_ & (FRAMEFLAG_KEYFRAME | FRAMEFLAG_DELTA)){
+        meta.Set("keyframe",(flags_ & FRAMEFLAG_KEYFRAME) != 0);
+    }
+    if (flags_ & FRAMEFLAG_DELTA){
+        JSONArray tiles;
+        for (unsigned run : tileRuns_){
+            tiles.Push(run);
+        }
+        JSONObject delta;
+        delta["tile_size"]=tileSize_;
+        delta["tiles"]=tiles;
+        meta.Set("delta",delta);
+    }
+
+    meta.Set("codec",FrameCodec::ToString(codec_));
+    meta.Set("raw_size",rawSize_);
+}
@@ -0,0 +1,106 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Container/Vector.h>
+
+#include "FrameInfo.h"
+#include "FrameCodec.h"
+
+namespace Urho3D
+{
+class JSONValue;
+}
+
+using namespace Urho3D;
+
+enum FrameFlags {
+    /// full frame (only set if delta tiles are enabled)
+    FRAMEFLAG_KEYFRAME = 1,
+    /// payload holds the changed tiles only (see tile runs)
+    FRAMEFLAG_DELTA = 2,
+    /// lossy preview that gets refined once the view is idle
+    FRAMEFLAG_PREVIEW = 4,
+    /// rendered with a scale < 1, blender has to scale it to the view size
+    FRAMEFLAG_SCALED = 8,
+};
+
+/// Everything blender needs to know to decode a frame. Written either as json meta (legacy
+/// 'draw' message) or as versioned fixed layout binary header ('frame' message):
+///
+///   offset  type      field
+///    0      char[4]   magic "U3DF"
+///    4      uint16    version
+///    6      uint16    size of the fixed part (88), tile runs follow it
+///    8      uint32    sequence
+///   12      uint32    width
+///   16      uint32    height
+///   20      uint32    stride (bytes per row of the uncompressed rgba8 frame)
+///   24      uint8     pixel format (FramePixelFormat)
+///   25      uint8     codec (FrameCodecType)
+///   26      uint16    flags (FrameFlags)
+///   28      float32   fov
+///   32      float32   initial fov
+///   36      uint32    view width
+///   40      uint32    view height
+///   44      uint32    raw size (payload size before the codec)
+///   48      uint64    render timestamp (usec, monotonic)
+///   56      uint64    send timestamp (usec, monotonic)
+///   64      uint16    tile size
+///   66      uint16    reserved
+///   68      uint32    number of tile runs
+///   72      uint64    client timestamp of the input this frame answers (version 2)
+///   80      uint32    input sequence of that input, 0 if none (version 2)
+///   84      uint32    reserved
+///   88      uint32[2] tile runs (first tile, count), row-major tile indices
+///
+/// All values are little endian. Total size is the fixed part + 8 bytes per tile run.
+struct FrameHeader
+{
+    static const unsigned VERSION = 2;
+    static const unsigned FIXED_SIZE = 88;
+
+    FrameHeader();
+    /// Start a new frame.
+    void Reset(const FrameInfo& info);
+    /// Store the changed tiles as runs of consecutive indices.
+    void SetTiles(unsigned tileSize,const PODVector<unsigned>& tiles);
+
+    /// Serialize into dest (resized to the header size, no allocation once it is big enough).
+    void WriteBinary(PODVector<unsigned char>& dest) const;
+    /// Parse a binary header. Returns false if it is no frame header or truncated. Fields newer than the
+    /// version of the header are left at zero.
+    bool ReadBinary(const unsigned char* data,unsigned size);
+    /// Serialize into a json object (meta of the legacy 'draw' message).
+    void WriteJSON(JSONValue& dest) const;
+
+    FrameInfo info_;
+    FramePixelFormat format_;
+    FrameCodecType codec_;
+    unsigned flags_;
+    unsigned rawSize_;
+    unsigned tileSize_;
+    /// (first,count) pairs
+    PODVector<unsigned> tileRuns_;
+    unsigned long long sendTimestamp_;
+};
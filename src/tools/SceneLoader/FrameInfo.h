@@ -0,0 +1,108 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <chrono>
+#include <cstring>
+
+/// Monotonic timestamp in microseconds, used to stamp frames on their way through the pipeline.
+inline unsigned long long GetMonotonicUSec()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+/// Points an input from blender passes on its way to the frame that shows it.
+enum LatencyStage {
+    /// the network thread took the message from the socket
+    STAGE_RECEIVE = 0,
+    /// the camera was updated (ViewRenderer::SetViewData)
+    STAGE_APPLY,
+    /// the render of the view was requested
+    STAGE_RENDER_QUEUED,
+    /// all views of the frame were rendered (E_ENDALLVIEWSRENDER)
+    STAGE_RENDERED,
+    /// the pixels were read back
+    STAGE_READBACK,
+    /// the frame was encoded and handed to the network thread
+    STAGE_SENT,
+    MAX_LATENCY_STAGES
+};
+
+/// Sequence id and client timestamp of a view update from blender and the GetMonotonicUSec()
+/// of each stage it passed. inputSeq_ 0 means the frame was not triggered by an input.
+struct LatencyTrace {
+    LatencyTrace()
+        : inputSeq_(0)
+        , clientTime_(0)
+    {
+        memset(stamps_,0,sizeof(stamps_));
+    }
+
+    inline bool IsValid() const { return inputSeq_ != 0; }
+    inline void Stamp(LatencyStage stage) { stamps_[stage] = GetMonotonicUSec(); }
+
+    unsigned inputSeq_;
+    /// timestamp of blender's clock, echoed back unchanged
+    unsigned long long clientTime_;
+    unsigned long long stamps_[MAX_LATENCY_STAGES];
+};
+
+/// Describes one frame of a ViewRenderer on its way from the gpu to blender.
+struct FrameInfo {
+    FrameInfo()
+        : width_(0)
+        , height_(0)
+        , dataSize_(0)
+        , fov_(0)
+        , initialFov_(0)
+        , interactive_(false)
+        , viewWidth_(0)
+        , viewHeight_(0)
+        , scale_(1.0f)
+        , sequence_(0)
+        , renderTimestamp_(0)
+    {}
+
+    /// size of the frame in pixels
+    int width_;
+    int height_;
+    /// size of the rgba pixel data in bytes
+    unsigned dataSize_;
+    /// camera fov the frame was rendered with
+    float fov_;
+    /// fov blender requested when the view was created/resized
+    float initialFov_;
+    /// rendered while the user was navigating the view (may be sent lossy)
+    bool interactive_;
+    /// size of the view in blender, the frame is smaller if it was rendered with a scale < 1
+    int viewWidth_;
+    int viewHeight_;
+    float scale_;
+    /// per view frame number, blender acknowledges it once the frame is drawn
+    unsigned sequence_;
+    /// GetMonotonicUSec() when the readback was queued
+    unsigned long long renderTimestamp_;
+    /// the input this frame answers
+    LatencyTrace trace_;
+};
@@ -0,0 +1,231 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "FrameReadback.h"
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Graphics/Graphics.h>
+#include <Urho3D/Graphics/Texture2D.h>
+#include <Urho3D/IO/Log.h>
+
+#ifdef URHO3D_OPENGL
+#include <Urho3D/Graphics/OpenGL/OGLGraphicsImpl.h>
+#endif
+
+// pixel buffer objects and fences are only available on desktop gl3
+#if defined(URHO3D_OPENGL) && !defined(GL_ES_VERSION_2_0)
+#define FRAMEREADBACK_ASYNC
+#endif
+
+FrameReadback::FrameReadback(Context* ctx, unsigned numBuffers)
+    : ctx_(ctx)
+    , readIndex_(0)
+    , numQueued_(0)
+    , async_(false)
+    , fbo_(0)
+{
+    slots_.Resize(Max(numBuffers,1U));
+
+#ifdef FRAMEREADBACK_ASYNC
+    Graphics* graphics = ctx_->GetSubsystem<Graphics>();
+    async_ = graphics && graphics->IsInitialized() && Graphics::GetGL3Support();
+    if (async_){
+        glGenFramebuffers(1,&fbo_);
+    } else {
+        URHO3D_LOGWARNING("FrameReadback: no gl3 support, using synchronous readback");
+    }
+#endif
+}
+
+FrameReadback::~FrameReadback()
+{
+    ReleaseGPUObjects();
+}
+
+void FrameReadback::Queue(Texture2D* texture, const IntRect& rect, const FrameInfo& info)
+{
+    if (IsFull()){
+        URHO3D_LOGERROR("FrameReadback: queue is full, frame dropped");
+        return;
+    }
+
+    Slot& slot = slots_[(readIndex_ + numQueued_) % slots_.Size()];
+    slot.info_ = info;
+    slot.info_.width_ = rect.Width();
+    slot.info_.height_ = rect.Height();
+    slot.info_.dataSize_ = rect.Width() * rect.Height() * 4;
+    slot.age_ = 0;
+
+    for (unsigned i=0; i < numQueued_; i++){
+        slots_[(readIndex_ + i) % slots_.Size()].age_++;
+    }
+    numQueued_++;
+
+    if (async_){
+        QueueAsync(slot,texture,rect);
+    } else {
+        QueueSync(slot,texture,rect);
+    }
+}
+
+bool FrameReadback::IsReady(FrameInfo& info, bool wait)
+{
+    if (IsEmpty()){
+        return false;
+    }
+
+    Slot& slot = slots_[readIndex_];
+    bool ready = !async_ || wait;
+
+#ifdef FRAMEREADBACK_ASYNC
+    if (async_ && slot.fence_){
+        GLuint64 timeout = wait ? 1000000000 : 0;
+        GLenum result = glClientWaitSync((GLsync)slot.fence_,GL_SYNC_FLUSH_COMMANDS_BIT,timeout);
+        ready = result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+        if (!ready && wait){
+            URHO3D_LOGWARNING("FrameReadback: timeout while waiting for the gpu");
+            // mapping the buffer will block until the copy is done
+            ready = true;
+        }
+    }
+    else if (async_ && !wait){
+        // no fences: assume the copy is done once all other buffers got queued
+        ready = slot.age_ + 1 >= slots_.Size();
+    }
+#endif
+
+    if (ready){
+        info = slot.info_;
+    }
+    return ready;
+}
+
+void FrameReadback::Read(unsigned char* dest)
+{
+    if (IsEmpty()){
+        return;
+    }
+
+    Slot& slot = slots_[readIndex_];
+
+    if (async_){
+#ifdef FRAMEREADBACK_ASYNC
+        glBindBuffer(GL_PIXEL_PACK_BUFFER,slot.pbo_);
+        void* src = glMapBufferRange(GL_PIXEL_PACK_BUFFER,0,slot.info_.dataSize_,GL_MAP_READ_BIT);
+        if (src){
+            memcpy(dest,src,slot.info_.dataSize_);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        } else {
+            URHO3D_LOGERROR("FrameReadback: could not map pixel buffer");
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER,0);
+
+        if (slot.fence_){
+            glDeleteSync((GLsync)slot.fence_);
+            slot.fence_ = nullptr;
+        }
+#endif
+    } else {
+        memcpy(dest,slot.data_.Buffer(),slot.info_.dataSize_);
+    }
+
+    readIndex_ = (readIndex_ + 1) % slots_.Size();
+    numQueued_--;
+}
+
+void FrameReadback::QueueSync(Slot& slot, Texture2D* texture, const IntRect& rect)
+{
+    int texWidth = texture->GetWidth();
+    int texHeight = texture->GetHeight();
+
+    if (rect == IntRect(0,0,texWidth,texHeight)){
+        slot.data_.Resize(slot.info_.dataSize_);
+        texture->GetData(0,slot.data_.Buffer());
+        return;
+    }
+
+    // the texture can only be read as a whole, crop the requested rows afterwards
+    PODVector<unsigned char> full(texture->GetDataSize(texWidth,texHeight));
+    texture->GetData(0,full.Buffer());
+
+    unsigned rowSize = rect.Width() * 4;
+    slot.data_.Resize(slot.info_.dataSize_);
+    for (int y=0; y < rect.Height(); y++){
+        memcpy(&slot.data_[y * rowSize],&full[((rect.top_ + y) * texWidth + rect.left_) * 4],rowSize);
+    }
+}
+
+void FrameReadback::QueueAsync(Slot& slot, Texture2D* texture, const IntRect& rect)
+{
+#ifdef FRAMEREADBACK_ASYNC
+    if (!slot.pbo_){
+        glGenBuffers(1,&slot.pbo_);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER,slot.pbo_);
+    if (slot.pboCapacity_ < slot.info_.dataSize_){
+        glBufferData(GL_PIXEL_PACK_BUFFER,slot.info_.dataSize_,nullptr,GL_STREAM_READ);
+        slot.pboCapacity_ = slot.info_.dataSize_;
+    }
+
+    // read through our own framebuffer and restore the one bound by urho afterwards
+    GLint prevFbo = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING,&prevFbo);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER,fbo_);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER,GL_COLOR_ATTACHMENT0,GL_TEXTURE_2D,texture->GetGPUObjectName(),0);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT,4);
+    glReadPixels(rect.left_,rect.top_,rect.Width(),rect.Height(),GL_RGBA,GL_UNSIGNED_BYTE,nullptr);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER,GL_COLOR_ATTACHMENT0,GL_TEXTURE_2D,0,0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER,prevFbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER,0);
+
+    if (slot.fence_){
+        glDeleteSync((GLsync)slot.fence_);
+    }
+    slot.fence_ = GLEW_ARB_sync ? glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE,0) : nullptr;
+#endif
+}
+
+void FrameReadback::ReleaseGPUObjects()
+{
+#ifdef FRAMEREADBACK_ASYNC
+    Graphics* graphics = ctx_->GetSubsystem<Graphics>();
+    if (!async_ || !graphics || !graphics->IsInitialized()){
+        return;
+    }
+    for (Slot& slot : slots_){
+        if (slot.fence_){
+            glDeleteSync((GLsync)slot.fence_);
+            slot.fence_ = nullptr;
+        }
+        if (slot.pbo_){
+            glDeleteBuffers(1,&slot.pbo_);
+            slot.pbo_ = 0;
+            slot.pboCapacity_ = 0;
+        }
+    }
+    if (fbo_){
+        glDeleteFramebuffers(1,&fbo_);
+        fbo_ = 0;
+    }
+#endif
+}
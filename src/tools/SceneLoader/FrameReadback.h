@@ -0,0 +1,90 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Container/RefCounted.h>
+#include <Urho3D/Container/Vector.h>
+#include <Urho3D/Math/Rect.h>
+
+#include "FrameInfo.h"
+
+namespace Urho3D
+{
+class Context;
+class Texture2D;
+}
+
+using namespace Urho3D;
+
+/// Asynchronous readback of rendertextures. Every queued frame gets its own staging buffer
+/// (a pixel buffer object on desktop opengl) so the copy of frame K runs on the gpu while
+/// frame K+1 is rendered. The cpu picks up the pixels once the copy is finished, usually one
+/// frame later. Other graphics backends fall back to a synchronous Texture2D::GetData.
+class FrameReadback : public RefCounted
+{
+public:
+    FrameReadback(Context* ctx,unsigned numBuffers=2);
+    ~FrameReadback() override;
+
+    /// Copy the given rect of the texture into the next free staging buffer. The ring must not be full.
+    void Queue(Texture2D* texture,const IntRect& rect,const FrameInfo& info);
+    /// Return true if the oldest queued frame is available. With wait=true this blocks until the gpu is done.
+    bool IsReady(FrameInfo& info,bool wait=false);
+    /// Copy the oldest ready frame (info.dataSize_ bytes) to dest and free its staging buffer.
+    void Read(unsigned char* dest);
+
+    inline bool IsFull() const { return numQueued_ == slots_.Size(); }
+    inline bool IsEmpty() const { return numQueued_ == 0; }
+    inline unsigned GetNumBuffers() const { return slots_.Size(); }
+    inline bool IsAsync() const { return async_; }
+
+private:
+    struct Slot {
+        Slot() : pbo_(0), pboCapacity_(0), fence_(nullptr), age_(0) {}
+
+        FrameInfo info_;
+        /// gl pixel pack buffer (async mode)
+        unsigned pbo_;
+        /// bytes allocated for the pbo
+        unsigned pboCapacity_;
+        /// GLsync that signals when the copy into the pbo is done
+        void* fence_;
+        /// amount of frames queued after this one (used if there are no fences)
+        unsigned age_;
+        /// cpu copy of the frame (sync fallback)
+        PODVector<unsigned char> data_;
+    };
+
+    void QueueSync(Slot& slot,Texture2D* texture,const IntRect& rect);
+    void QueueAsync(Slot& slot,Texture2D* texture,const IntRect& rect);
+    void ReleaseGPUObjects();
+
+    Context* ctx_;
+    Vector<Slot> slots_;
+    /// index of the oldest queued slot
+    unsigned readIndex_;
+    unsigned numQueued_;
+    bool async_;
+    /// framebuffer used to read from the rendertextures
+    unsigned fbo_;
+};
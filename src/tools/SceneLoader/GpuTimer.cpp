@@ -0,0 +1,117 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "GpuTimer.h"
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Graphics/Graphics.h>
+
+#ifdef URHO3D_OPENGL
+#include <Urho3D/Graphics/OpenGL/OGLGraphicsImpl.h>
+#endif
+
+// timer queries are only available on desktop gl
+#if defined(URHO3D_OPENGL) && !defined(GL_ES_VERSION_2_0)
+#define GPUTIMER_QUERIES
+#endif
+
+GpuTimer::GpuTimer(Context* ctx, unsigned numQueries)
+    : ctx_(ctx)
+    , readIndex_(0)
+    , numPending_(0)
+    , active_(false)
+    , supported_(false)
+{
+    queries_.Resize(Max(numQueries,1U));
+
+#ifdef GPUTIMER_QUERIES
+    Graphics* graphics = ctx_->GetSubsystem<Graphics>();
+    supported_ = graphics && graphics->IsInitialized() && GLEW_ARB_timer_query;
+    if (supported_){
+        for (Query& query : queries_){
+            glGenQueries(1,&query.id_);
+        }
+    }
+#endif
+}
+
+GpuTimer::~GpuTimer()
+{
+#ifdef GPUTIMER_QUERIES
+    Graphics* graphics = ctx_->GetSubsystem<Graphics>();
+    if (!supported_ || !graphics || !graphics->IsInitialized()){
+        return;
+    }
+    for (Query& query : queries_){
+        glDeleteQueries(1,&query.id_);
+    }
+#endif
+}
+
+void GpuTimer::Begin(float scale)
+{
+#ifdef GPUTIMER_QUERIES
+    if (!supported_ || active_ || numPending_ == queries_.Size()){
+        return;
+    }
+    Query& query = queries_[(readIndex_ + numPending_) % queries_.Size()];
+    query.scale_ = scale;
+    glBeginQuery(GL_TIME_ELAPSED,query.id_);
+    active_ = true;
+#endif
+}
+
+void GpuTimer::End()
+{
+#ifdef GPUTIMER_QUERIES
+    if (!active_){
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    active_ = false;
+    numPending_++;
+#endif
+}
+
+bool GpuTimer::GetResult(float& gpuTime, float& scale)
+{
+    bool found = false;
+#ifdef GPUTIMER_QUERIES
+    // queries finish in order, stop at the first one that is not available yet
+    while (numPending_ > 0){
+        Query& query = queries_[readIndex_];
+        GLint available = 0;
+        glGetQueryObjectiv(query.id_,GL_QUERY_RESULT_AVAILABLE,&available);
+        if (!available){
+            break;
+        }
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(query.id_,GL_QUERY_RESULT,&nanoseconds);
+        gpuTime = nanoseconds / 1000000000.0f;
+        scale = query.scale_;
+        found = true;
+        readIndex_ = (readIndex_ + 1) % queries_.Size();
+        numPending_--;
+    }
+#endif
+    return found;
+}
@@ -0,0 +1,69 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Container/RefCounted.h>
+#include <Urho3D/Container/Vector.h>
+
+namespace Urho3D
+{
+class Context;
+}
+
+using namespace Urho3D;
+
+/// Measures the gpu time of the renders of a view with timer queries. Results arrive a frame or two
+/// later and are picked up without stalling. Needs desktop opengl with ARB_timer_query, otherwise
+/// IsSupported() is false and nothing is measured.
+class GpuTimer : public RefCounted
+{
+public:
+    GpuTimer(Context* ctx,unsigned numQueries=4);
+    ~GpuTimer() override;
+
+    /// Start measuring a render with the given scale. Skipped if all queries are still in flight.
+    void Begin(float scale);
+    void End();
+    /// Newest finished measurement (seconds) and the scale it was rendered with. Returns false if no
+    /// measurement finished since the last call.
+    bool GetResult(float& gpuTime,float& scale);
+
+    inline bool IsSupported() const { return supported_; }
+
+private:
+    struct Query {
+        Query() : id_(0), scale_(1.0f) {}
+
+        unsigned id_;
+        float scale_;
+    };
+
+    Context* ctx_;
+    Vector<Query> queries_;
+    /// index of the oldest query in flight
+    unsigned readIndex_;
+    unsigned numPending_;
+    /// a query was begun and not ended yet
+    bool active_;
+    bool supported_;
+};
@@ -0,0 +1,151 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "LatencyStats.h"
+
+#include <Urho3D/Math/MathDefs.h>
+#include <Urho3D/Resource/JSONValue.h>
+
+static const char* stageNames[] = {
+    "receive",
+    "apply",
+    "queued",
+    "rendered",
+    "readback",
+    "sent"
+};
+
+LatencyHistogram::LatencyHistogram()
+{
+    Clear();
+}
+
+void LatencyHistogram::Add(unsigned usec)
+{
+    counts_[GetBucket(usec)]++;
+    count_++;
+    max_ = Max(max_,usec);
+}
+
+void LatencyHistogram::Clear()
+{
+    memset(counts_,0,sizeof(counts_));
+    count_ = 0;
+    max_ = 0;
+}
+
+unsigned LatencyHistogram::GetPercentile(float fraction) const
+{
+    if (!count_){
+        return 0;
+    }
+    unsigned rank = Max((unsigned)CeilToInt(fraction * count_),1U);
+    unsigned seen = 0;
+    for (unsigned i=0; i < NUM_BUCKETS; i++){
+        seen += counts_[i];
+        if (seen >= rank){
+            return Min(GetBucketValue(i),max_);
+        }
+    }
+    return max_;
+}
+
+unsigned LatencyHistogram::GetBucket(unsigned usec)
+{
+    if (usec < SUB_BUCKETS){
+        return usec;
+    }
+    // exponent selects the group, the next bits below the top bit the sub bucket
+    unsigned exponent = LogBaseTwo(usec);
+    unsigned group = exponent - SUB_BUCKET_BITS + 1;
+    return group * SUB_BUCKETS + ((usec >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+}
+
+unsigned LatencyHistogram::GetBucketValue(unsigned bucket)
+{
+    if (bucket < SUB_BUCKETS){
+        return bucket;
+    }
+    unsigned group = bucket / SUB_BUCKETS;
+    unsigned subBucket = bucket % SUB_BUCKETS;
+    unsigned long long lower = (unsigned long long)(SUB_BUCKETS + subBucket) << (group - 1);
+    unsigned long long width = 1ULL << (group - 1);
+    return (unsigned)Min(lower + width / 2,(unsigned long long)M_MAX_UNSIGNED);
+}
+
+void LatencyStats::Add(const LatencyTrace& trace)
+{
+    for (unsigned i = STAGE_APPLY; i < MAX_LATENCY_STAGES; i++){
+        unsigned long long from = trace.stamps_[i-1];
+        unsigned long long to = trace.stamps_[i];
+        stages_[i].Add(to > from ? (unsigned)Min(to - from,(unsigned long long)M_MAX_UNSIGNED) : 0);
+    }
+    unsigned long long from = trace.stamps_[STAGE_RECEIVE];
+    unsigned long long to = trace.stamps_[STAGE_SENT];
+    total_.Add(to > from ? (unsigned)Min(to - from,(unsigned long long)M_MAX_UNSIGNED) : 0);
+}
+
+void LatencyStats::Clear()
+{
+    for (unsigned i=0; i < MAX_LATENCY_STAGES; i++){
+        stages_[i].Clear();
+    }
+    total_.Clear();
+}
+
+static void WriteHistogram(JSONValue& dest,const LatencyHistogram& histogram)
+{
+    dest.Set("count",histogram.GetCount());
+    dest.Set("p50",histogram.GetPercentile(0.50f));
+    dest.Set("p95",histogram.GetPercentile(0.95f));
+    dest.Set("p99",histogram.GetPercentile(0.99f));
+    dest.Set("max",histogram.GetMax());
+}
+
+void LatencyStats::WriteJSON(JSONValue& dest) const
+{
+    JSONValue total;
+    WriteHistogram(total,total_);
+    dest.Set("total",total);
+    for (unsigned i = STAGE_APPLY; i < MAX_LATENCY_STAGES; i++){
+        JSONValue stage;
+        WriteHistogram(stage,stages_[i]);
+        dest.Set(stageNames[i],stage);
+    }
+}
+
+String LatencyStats::ToString() const
+{
+    String result;
+    result.AppendWithFormat("total p50:%u p95:%u p99:%u",total_.GetPercentile(0.50f),total_.GetPercentile(0.95f),total_.GetPercentile(0.99f));
+    for (unsigned i = STAGE_APPLY; i < MAX_LATENCY_STAGES; i++){
+        const LatencyHistogram& stage = stages_[i];
+        result.AppendWithFormat(" | %s p50:%u p95:%u p99:%u",stageNames[i],stage.GetPercentile(0.50f),stage.GetPercentile(0.95f),stage.GetPercentile(0.99f));
+    }
+    result.AppendWithFormat(" (usec, %u frames)",total_.GetCount());
+    return result;
+}
+
+const char* LatencyStats::GetStageName(LatencyStage stage)
+{
+    return stageNames[stage];
+}
@@ -0,0 +1,88 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Container/Str.h>
+
+#include "FrameInfo.h"
+
+namespace Urho3D
+{
+class JSONValue;
+}
+
+using namespace Urho3D;
+
+/// Histogram of latencies in microseconds with log-linear buckets (16 sub-buckets per power of
+/// two, so percentiles are within ~6% of the real value). Fixed size, adding never allocates.
+class LatencyHistogram
+{
+public:
+    static const unsigned SUB_BUCKET_BITS = 4;
+    static const unsigned SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const unsigned NUM_BUCKETS = (32 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    LatencyHistogram();
+
+    void Add(unsigned usec);
+    void Clear();
+    /// latency (usec) below which the given fraction (0..1) of the samples lies
+    unsigned GetPercentile(float fraction) const;
+    inline unsigned GetCount() const { return count_; }
+    inline unsigned GetMax() const { return max_; }
+
+private:
+    static unsigned GetBucket(unsigned usec);
+    /// middle of the bucket's value range
+    static unsigned GetBucketValue(unsigned bucket);
+
+    unsigned counts_[NUM_BUCKETS];
+    unsigned count_;
+    unsigned max_;
+};
+
+/// Latency histograms of one view: one per stage for the time since the previous stage, plus
+/// the total from receiving the input to sending the frame.
+class LatencyStats
+{
+public:
+    /// Add the stamps of a frame that answered an input.
+    void Add(const LatencyTrace& trace);
+    void Clear();
+
+    /// time from the previous stage to stage (STAGE_RECEIVE is not used)
+    inline const LatencyHistogram& GetStage(LatencyStage stage) const { return stages_[stage]; }
+    /// time from receive to sent
+    inline const LatencyHistogram& GetTotal() const { return total_; }
+
+    /// {"total":{"count","p50","p95","p99","max"},"apply":{...},...} in microseconds
+    void WriteJSON(JSONValue& dest) const;
+    /// one line summary for the log
+    String ToString() const;
+
+    static const char* GetStageName(LatencyStage stage);
+
+private:
+    LatencyHistogram stages_[MAX_LATENCY_STAGES];
+    LatencyHistogram total_;
+};
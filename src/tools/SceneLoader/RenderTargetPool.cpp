@@ -0,0 +1,161 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "RenderTargetPool.h"
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Graphics/Camera.h>
+#include <Urho3D/Graphics/Graphics.h>
+#include <Urho3D/Graphics/RenderSurface.h>
+#include <Urho3D/Graphics/Texture2D.h>
+#include <Urho3D/Graphics/Viewport.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Scene/Scene.h>
+
+RenderTarget::RenderTarget(Context* ctx, int width, int height)
+    : width_(width)
+    , height_(height)
+    , inUse_(false)
+    , releaseTime_(0)
+{
+    texture_ = new Texture2D(ctx);
+    texture_->SetSize(width,height,Graphics::GetRGBAFormat(),TEXTURE_RENDERTARGET);
+    texture_->SetFilterMode(FILTER_BILINEAR);
+    surface_ = texture_->GetRenderSurface();
+    surface_->SetUpdateMode(SURFACE_MANUALUPDATE);
+    viewports_.Push(SharedPtr<Viewport>(new Viewport(ctx)));
+}
+
+RenderTarget::~RenderTarget()
+{
+    if (surface_){
+        surface_->SetNumViewports(0);
+    }
+}
+
+void RenderTarget::SetView(Scene* scene, Camera* camera, int width, int height)
+{
+    rect_ = IntRect(0,0,Min(width,width_),Min(height,height_));
+    SetNumViews(1);
+    SetView(0,scene,camera,rect_);
+    surface_->QueueUpdate();
+}
+
+void RenderTarget::SetNumViews(unsigned count)
+{
+    count = Max(count,1U);
+    while (viewports_.Size() < count){
+        viewports_.Push(SharedPtr<Viewport>(new Viewport(texture_->GetContext())));
+    }
+    surface_->SetNumViewports(count);
+    for (unsigned i = 0; i < count; ++i){
+        surface_->SetViewport(i,viewports_[i]);
+    }
+}
+
+void RenderTarget::SetView(unsigned index, Scene* scene, Camera* camera, const IntRect& rect)
+{
+    Viewport* viewport = viewports_[index];
+    viewport->SetScene(scene);
+    viewport->SetCamera(camera);
+    viewport->SetRect(rect);
+}
+
+IntRect RenderTarget::GetReadbackRect() const
+{
+    return ToReadbackRect(rect_);
+}
+
+IntRect RenderTarget::ToReadbackRect(const IntRect& rect) const
+{
+#ifdef URHO3D_OPENGL
+    // viewport rects count rows from the top, gl stores them from the bottom: the top left rect
+    // ends up in the last rows of the texture
+    return IntRect(rect.left_,height_ - rect.bottom_,rect.right_,height_ - rect.top_);
+#else
+    return rect;
+#endif
+}
+
+RenderTargetPool::RenderTargetPool(Context* ctx)
+    : ctx_(ctx)
+    , idleTimeout_(10.0f)
+{
+}
+
+int RenderTargetPool::GetBucketSize(int size)
+{
+    return Max((size + BUCKET_SIZE - 1) / BUCKET_SIZE,1) * BUCKET_SIZE;
+}
+
+bool RenderTargetPool::Fits(const RenderTarget* target, int width, int height)
+{
+    return target && target->GetWidth() == GetBucketSize(width) && target->GetHeight() == GetBucketSize(height);
+}
+
+RenderTarget* RenderTargetPool::Acquire(int width, int height)
+{
+    int bucketWidth = GetBucketSize(width);
+    int bucketHeight = GetBucketSize(height);
+
+    for (RenderTarget* target : targets_){
+        if (!target->inUse_ && target->width_ == bucketWidth && target->height_ == bucketHeight){
+            target->inUse_ = true;
+            return target;
+        }
+    }
+
+    RenderTarget* target = new RenderTarget(ctx_,bucketWidth,bucketHeight);
+    target->inUse_ = true;
+    targets_.Push(SharedPtr<RenderTarget>(target));
+    URHO3D_LOGDEBUGF("RenderTargetPool: created %ix%i (%u targets)",bucketWidth,bucketHeight,targets_.Size());
+    return target;
+}
+
+void RenderTargetPool::Release(RenderTarget* target)
+{
+    if (!target){
+        return;
+    }
+    // nothing renders into an unused target
+    target->surface_->SetNumViewports(0);
+    target->surface_->ResetUpdateQueued();
+    for (Viewport* viewport : target->viewports_){
+        viewport->SetScene(nullptr);
+        viewport->SetCamera(nullptr);
+    }
+    target->inUse_ = false;
+    target->releaseTime_ = ctx_->GetSubsystem<Time>()->GetElapsedTime();
+}
+
+void RenderTargetPool::Update()
+{
+    float now = ctx_->GetSubsystem<Time>()->GetElapsedTime();
+    for (int i = (int)targets_.Size() - 1; i >= 0; i--){
+        RenderTarget* target = targets_[i];
+        if (!target->inUse_ && now - target->releaseTime_ > idleTimeout_){
+            URHO3D_LOGDEBUGF("RenderTargetPool: freed %ix%i",target->width_,target->height_);
+            targets_.Erase(i);
+        }
+    }
+}
@@ -0,0 +1,115 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Container/Ptr.h>
+#include <Urho3D/Container/RefCounted.h>
+#include <Urho3D/Container/Vector.h>
+#include <Urho3D/Math/Rect.h>
+
+namespace Urho3D
+{
+class Camera;
+class Context;
+class RenderSurface;
+class Scene;
+class Texture2D;
+class Viewport;
+}
+
+using namespace Urho3D;
+
+/// Render texture with its viewport, handed out by a RenderTargetPool. The texture has the size of
+/// a bucket, the view renders into its top left corner. A ViewAtlas renders several views side by
+/// side, each with its own viewport.
+class RenderTarget : public RefCounted
+{
+    friend class RenderTargetPool;
+
+public:
+    RenderTarget(Context* ctx,int width,int height);
+    ~RenderTarget() override;
+
+    inline Texture2D* GetTexture() const { return texture_; }
+    inline RenderSurface* GetSurface() const { return surface_; }
+    inline Viewport* GetViewport() const { return viewports_[0]; }
+    inline Viewport* GetViewport(unsigned index) const { return viewports_[index]; }
+    inline int GetWidth() const { return width_; }
+    inline int GetHeight() const { return height_; }
+
+    /// Render the scene with the camera into width x height pixels and queue an update.
+    void SetView(Scene* scene,Camera* camera,int width,int height);
+    /// Render count views into the texture, viewports are created as needed.
+    void SetNumViews(unsigned count);
+    /// Render view index into rect of the texture. Doesn't queue an update.
+    void SetView(unsigned index,Scene* scene,Camera* camera,const IntRect& rect);
+    /// rendered pixels (top left origin like Viewport::GetRect())
+    inline const IntRect& GetRect() const { return rect_; }
+    /// rendered pixels as FrameReadback reads them (rows in texture memory order)
+    IntRect GetReadbackRect() const;
+    /// rect of the texture as FrameReadback reads it
+    IntRect ToReadbackRect(const IntRect& rect) const;
+
+private:
+    SharedPtr<Texture2D> texture_;
+    SharedPtr<RenderSurface> surface_;
+    Vector<SharedPtr<Viewport> > viewports_;
+    int width_;
+    int height_;
+    IntRect rect_;
+    bool inUse_;
+    /// Time::GetElapsedTime() when it was released
+    float releaseTime_;
+};
+
+/// Render targets of all views, keyed by their size rounded up to BUCKET_SIZE. A resize within
+/// the bucket only changes the viewport rect, a resize to another bucket swaps in a pooled target,
+/// so dragging a region border in blender doesn't reallocate textures every frame. Targets that
+/// were not used for the idle timeout are freed.
+class RenderTargetPool : public RefCounted
+{
+public:
+    static const int BUCKET_SIZE = 128;
+
+    explicit RenderTargetPool(Context* ctx);
+
+    /// free target of the bucket width x height falls into, created if there is none
+    RenderTarget* Acquire(int width,int height);
+    /// give the target back, its update is cancelled
+    void Release(RenderTarget* target);
+    /// true if width x height fits the bucket of target
+    static bool Fits(const RenderTarget* target,int width,int height);
+    static int GetBucketSize(int size);
+
+    /// seconds an unused target is kept
+    inline void SetIdleTimeout(float timeout) { idleTimeout_ = timeout; }
+    /// free targets that are unused longer than the idle timeout. Called once per frame.
+    void Update();
+
+    inline unsigned GetNumTargets() const { return targets_.Size(); }
+
+private:
+    Context* ctx_;
+    Vector<SharedPtr<RenderTarget> > targets_;
+    float idleTimeout_;
+};
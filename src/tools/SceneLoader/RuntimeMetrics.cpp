@@ -0,0 +1,141 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "RuntimeMetrics.h"
+
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Resource/JSONFile.h>
+#include <Urho3D/Resource/ResourceCache.h>
+
+#include "BlenderNetwork.h"
+#include "LatencyStats.h"
+
+RuntimeMetrics::RuntimeMetrics(Context* context)
+    : Object(context)
+    , interval_(1.0f)
+    , lastPublish_(0)
+    , numFrames_(0)
+    , frameTimeSum_(0)
+    , frameTimeMax_(0)
+    , numReadbacks_(0)
+    , readbackTimeSum_(0)
+    , readbackTimeMax_(0)
+    , lastReceived_(0)
+    , lastBytesSent_(0)
+    , lastDropped_(0)
+    , lastCoalesced_(0)
+{
+}
+
+void RuntimeMetrics::SetInterval(float interval)
+{
+    interval_ = Max(interval,0.0f);
+}
+
+void RuntimeMetrics::AddFrameTime(float frameTime)
+{
+    numFrames_++;
+    frameTimeSum_ += frameTime;
+    frameTimeMax_ = Max(frameTimeMax_,frameTime);
+}
+
+void RuntimeMetrics::AddReadbackTime(float readbackTime)
+{
+    numReadbacks_++;
+    readbackTimeSum_ += readbackTime;
+    readbackTimeMax_ = Max(readbackTimeMax_,readbackTime);
+}
+
+bool RuntimeMetrics::IsDue() const
+{
+    return interval_ > 0 && GetSubsystem<Time>()->GetElapsedTime() - lastPublish_ >= interval_;
+}
+
+void RuntimeMetrics::AddView(const String& client, int viewId, ViewMetrics& metrics, const LatencyStats& latency)
+{
+    JSONValue view;
+    view.Set("id",viewId);
+    if (!client.Empty()){
+        view.Set("client",client);
+    }
+    view.Set("rendered",metrics.framesRendered_);
+    view.Set("sent",metrics.framesSent_);
+    view.Set("bytes",(double)metrics.bytesSent_);
+    const LatencyHistogram& total = latency.GetTotal();
+    if (total.GetCount()){
+        JSONValue latencyJson;
+        latencyJson.Set("p50",total.GetPercentile(0.50f));
+        latencyJson.Set("p95",total.GetPercentile(0.95f));
+        latencyJson.Set("p99",total.GetPercentile(0.99f));
+        view.Set("latency",latencyJson);
+    }
+    views_.Push(view);
+    metrics.Clear();
+}
+
+void RuntimeMetrics::Publish()
+{
+    float now = GetSubsystem<Time>()->GetElapsedTime();
+    float elapsed = Max(now - lastPublish_,M_EPSILON);
+
+    BlenderNetwork* network = GetSubsystem<BlenderNetwork>();
+    unsigned long long received = network->GetNumReceived();
+    unsigned long long bytesSent = network->GetBytesSent();
+    unsigned dropped = network->GetNumDropped();
+    unsigned coalesced = network->GetNumCoalesced();
+
+    JSONFile snapshot(context_);
+    JSONValue& root = snapshot.GetRoot();
+    root.Set("interval",elapsed);
+
+    // times in milliseconds
+    JSONValue frameTime;
+    frameTime.Set("avg",numFrames_ ? frameTimeSum_ / numFrames_ * 1000.0f : 0.0f);
+    frameTime.Set("max",frameTimeMax_ * 1000.0f);
+    root.Set("frames",numFrames_);
+    root.Set("frame_time",frameTime);
+
+    JSONValue readbackTime;
+    readbackTime.Set("avg",numReadbacks_ ? readbackTimeSum_ / numReadbacks_ * 1000.0f : 0.0f);
+    readbackTime.Set("max",readbackTimeMax_ * 1000.0f);
+    root.Set("readback_time",readbackTime);
+
+    root.Set("msgs_per_sec",(float)(received - lastReceived_) / elapsed);
+    root.Set("dropped",dropped - lastDropped_);
+    root.Set("coalesced",coalesced - lastCoalesced_);
+    root.Set("bytes_sent",(double)(bytesSent - lastBytesSent_));
+    root.Set("cache_memory",(double)GetSubsystem<ResourceCache>()->GetTotalMemoryUse());
+    root.Set("views",views_);
+
+    network->SendJSON("runtime","stats",snapshot.ToString(""));
+
+    lastPublish_ = now;
+    lastReceived_ = received;
+    lastBytesSent_ = bytesSent;
+    lastDropped_ = dropped;
+    lastCoalesced_ = coalesced;
+    numFrames_ = 0;
+    frameTimeSum_ = frameTimeMax_ = 0;
+    numReadbacks_ = 0;
+    readbackTimeSum_ = readbackTimeMax_ = 0;
+    views_.Clear();
+}
@@ -0,0 +1,92 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Resource/JSONValue.h>
+
+using namespace Urho3D;
+
+class LatencyStats;
+
+/// Counters of one view for the current metrics interval.
+struct ViewMetrics
+{
+    ViewMetrics() { Clear(); }
+    void Clear()
+    {
+        framesRendered_ = 0;
+        framesSent_ = 0;
+        bytesSent_ = 0;
+    }
+
+    unsigned framesRendered_;
+    unsigned framesSent_;
+    unsigned long long bytesSent_;
+};
+
+/// Collects runtime counters and publishes a snapshot as 'runtime stats' (json) through the
+/// BlenderNetwork once per interval, so the add-on or a terminal tool can watch the runtime.
+class RuntimeMetrics : public Object
+{
+    URHO3D_OBJECT(RuntimeMetrics, Object);
+
+public:
+    explicit RuntimeMetrics(Context* context);
+
+    /// seconds between snapshots, 0 disables publishing
+    void SetInterval(float interval);
+    inline float GetInterval() const { return interval_; }
+
+    /// main loop time of one frame (seconds)
+    void AddFrameTime(float frameTime);
+    /// time to read one frame back from the gpu (seconds)
+    void AddReadbackTime(float readbackTime);
+
+    /// true once the interval passed. Then AddView() each view and Publish().
+    bool IsDue() const;
+    /// Add the counters of the view to the snapshot and reset them.
+    void AddView(const String& client,int viewId,ViewMetrics& metrics,const LatencyStats& latency);
+    /// Send the snapshot and start the next interval.
+    void Publish();
+
+private:
+    float interval_;
+    /// Time::GetElapsedTime() of the last snapshot
+    float lastPublish_;
+
+    unsigned numFrames_;
+    float frameTimeSum_;
+    float frameTimeMax_;
+    unsigned numReadbacks_;
+    float readbackTimeSum_;
+    float readbackTimeMax_;
+
+    /// network counters at the last snapshot
+    unsigned long long lastReceived_;
+    unsigned long long lastBytesSent_;
+    unsigned lastDropped_;
+    unsigned lastCoalesced_;
+
+    JSONArray views_;
+};
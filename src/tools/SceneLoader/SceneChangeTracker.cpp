@@ -0,0 +1,127 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "SceneChangeTracker.h"
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Graphics/Drawable.h>
+#include <Urho3D/Scene/Node.h>
+#include <Urho3D/Scene/Scene.h>
+#include <Urho3D/Scene/SceneEvents.h>
+
+SceneChangeTracker::SceneChangeTracker(Context* ctx, Scene* scene)
+    : Component(ctx)
+    , trackedScene_(scene)
+{
+    PODVector<Drawable*> drawables;
+    scene->GetDerivedComponents<Drawable>(drawables,true);
+    for (Drawable* drawable : drawables){
+        Node* node = drawable->GetNode();
+        node->AddListener(this);
+        BoundingBox bounds;
+        if (GetBounds(node,bounds)){
+            bounds_[node->GetID()] = bounds;
+        }
+    }
+
+    SubscribeToEvent(scene,E_NODEADDED,URHO3D_HANDLER(SceneChangeTracker,HandleNodeChanged));
+    SubscribeToEvent(scene,E_NODEREMOVED,URHO3D_HANDLER(SceneChangeTracker,HandleNodeChanged));
+    SubscribeToEvent(scene,E_NODEENABLEDCHANGED,URHO3D_HANDLER(SceneChangeTracker,HandleNodeChanged));
+    SubscribeToEvent(scene,E_COMPONENTADDED,URHO3D_HANDLER(SceneChangeTracker,HandleComponentChanged));
+    SubscribeToEvent(scene,E_COMPONENTREMOVED,URHO3D_HANDLER(SceneChangeTracker,HandleComponentChanged));
+    SubscribeToEvent(scene,E_COMPONENTENABLEDCHANGED,URHO3D_HANDLER(SceneChangeTracker,HandleComponentChanged));
+}
+
+void SceneChangeTracker::OnMarkedDirty(Node* node)
+{
+    dirtyNodes_.Insert(node->GetID());
+}
+
+void SceneChangeTracker::HandleNodeChanged(StringHash eventType, VariantMap& eventData)
+{
+    // the parameter names are the same for all node events
+    using namespace NodeAdded;
+    MarkChanged(static_cast<Node*>(eventData[P_NODE].GetPtr()));
+}
+
+void SceneChangeTracker::HandleComponentChanged(StringHash eventType, VariantMap& eventData)
+{
+    using namespace ComponentAdded;
+    Component* component = static_cast<Component*>(eventData[P_COMPONENT].GetPtr());
+    if (!component || !component->IsInstanceOf<Drawable>()){
+        return;
+    }
+    Node* node = static_cast<Node*>(eventData[P_NODE].GetPtr());
+    if (eventType == E_COMPONENTADDED){
+        node->AddListener(this);
+    }
+    dirtyNodes_.Insert(node->GetID());
+}
+
+void SceneChangeTracker::MarkChanged(Node* node)
+{
+    if (!node){
+        return;
+    }
+    // a removed node takes its children with it without further events
+    dirtyNodes_.Insert(node->GetID());
+    PODVector<Node*> children;
+    node->GetChildren(children,true);
+    for (Node* child : children){
+        dirtyNodes_.Insert(child->GetID());
+    }
+}
+
+void SceneChangeTracker::FlushChanges(PODVector<BoundingBox>& changedBounds)
+{
+    for (unsigned id : dirtyNodes_){
+        HashMap<unsigned,BoundingBox>::Iterator it = bounds_.Find(id);
+        if (it != bounds_.End()){
+            // the views have to draw what was behind it
+            changedBounds.Push(it->second_);
+        }
+        Node* node = trackedScene_ ? trackedScene_->GetNode(id) : nullptr;
+        BoundingBox bounds;
+        if (node && GetBounds(node,bounds)){
+            changedBounds.Push(bounds);
+            bounds_[id] = bounds;
+        } else if (it != bounds_.End()){
+            bounds_.Erase(it);
+        }
+    }
+    dirtyNodes_.Clear();
+}
+
+bool SceneChangeTracker::GetBounds(Node* node, BoundingBox& bounds)
+{
+    if (!node->IsEnabled()){
+        return false;
+    }
+    PODVector<Drawable*> drawables;
+    node->GetDerivedComponents<Drawable>(drawables);
+    for (Drawable* drawable : drawables){
+        if (drawable->IsEnabledEffective()){
+            bounds.Merge(drawable->GetWorldBoundingBox());
+        }
+    }
+    return bounds.Defined();
+}
@@ -0,0 +1,70 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Container/HashMap.h>
+#include <Urho3D/Container/HashSet.h>
+#include <Urho3D/Math/BoundingBox.h>
+#include <Urho3D/Scene/Component.h>
+
+namespace Urho3D
+{
+class Scene;
+}
+
+using namespace Urho3D;
+
+/// Collects the parts of a scene that changed since the last flush, so only the views that see them
+/// are rendered again. Structural changes come from the node and component events of the scene,
+/// transform changes from listening to every node with a drawable. It is not part of the scene,
+/// reloading the scene keeps it.
+class SceneChangeTracker : public Component
+{
+    URHO3D_OBJECT(SceneChangeTracker, Component);
+
+public:
+    SceneChangeTracker(Context* ctx,Scene* scene);
+
+    inline Scene* GetTrackedScene() const { return trackedScene_; }
+    inline bool HasChanges() const { return !dirtyNodes_.Empty(); }
+    /// Add the world bounding boxes of the changed nodes before and after the change to changedBounds and clear the changes.
+    void FlushChanges(PODVector<BoundingBox>& changedBounds);
+
+protected:
+    /// transform of a tracked node (or one of its parents) changed
+    void OnMarkedDirty(Node* node) override;
+
+private:
+    void HandleNodeChanged(StringHash eventType,VariantMap& eventData);
+    void HandleComponentChanged(StringHash eventType,VariantMap& eventData);
+    /// mark the node and its children as changed
+    void MarkChanged(Node* node);
+    /// merged world bounding box of the enabled drawables of the node, false if there is none
+    static bool GetBounds(Node* node,BoundingBox& bounds);
+
+    WeakPtr<Scene> trackedScene_;
+    /// ids of the nodes changed since the last flush
+    HashSet<unsigned> dirtyNodes_;
+    /// bounds of the nodes with drawables at the last flush, to know where a moved or removed node was
+    HashMap<unsigned,BoundingBox> bounds_;
+};
@@ -31,6 +31,7 @@
 #include <Urho3D/UI/UI.h>
 #include <Urho3D/UI/UIEvents.h>
 #include <Urho3D/Resource/ResourceEvents.h>
+#include <SDL/SDL.h>
 #include <Urho3D/DebugNew.h>
 #include <Urho3D/Resource/XMLFile.h>
 
@@ -69,14 +70,37 @@ SceneLoader::SceneLoader(Context* context) :
     settings.showPhysics = false;
     settings.showPhysicsDepth = true;
     settings.activatePhysics = false;
+    settings.readbackBuffers = 2;
+    settings.deltaTiles = false;
+    settings.tileSize = 32;
+    settings.keyframeInterval = 60;
+    settings.codec = CODEC_RAW;
+    settings.progressive = false;
+    settings.idleTime = 0.25f;
+    settings.dynamicResolution = false;
+    settings.targetFrameTime = 1.0f / 60.0f;
+    settings.minScale = 0.25f;
+    settings.maxFramesInFlight = 0;
+    settings.ackTimeout = 1.0f;
+    settings.binaryHeader = false;
+    settings.atlas = false;
 
     // register component exporter
     context->RegisterSubsystem(new Urho3DNodeTreeExporter(context));
 
+    // connected in Start(), the endpoints can be set on the command line
     BlenderNetwork* bN = new BlenderNetwork(context);
-    bN->InitNetwork();
     context->RegisterSubsystem(bN);
 
+    metrics_ = new RuntimeMetrics(context);
+    renderTargets_ = new RenderTargetPool(context);
+    replayExitDelay_ = -1.0f;
+    serverMode_ = false;
+    idleMode_ = true;
+    idleWakeInterval_ = 0.25f;
+    idleDelay_ = 0.5f;
+    lastActivityTime_ = 0;
+
 
     // register group instance component
     CommonComponents::RegisterComponents(context);
@@ -85,6 +109,26 @@ SceneLoader::SceneLoader(Context* context) :
     engineParameters_[EP_WINDOW_RESIZABLE]=true;
 }
 
+void SceneLoader::Setup()
+{
+    Sample::Setup();
+
+    // the window is created before Start() parses the arguments
+    for (const String& arg : GetArguments()){
+        if (arg == "--server"){
+            serverMode_ = true;
+        }
+    }
+    if (serverMode_){
+        // the window only provides the gl context and is hidden right after startup
+        engineParameters_[EP_WINDOW_WIDTH]=64;
+        engineParameters_[EP_WINDOW_HEIGHT]=64;
+        engineParameters_[EP_WINDOW_RESIZABLE]=false;
+        engineParameters_[EP_MULTI_SAMPLE]=1;
+        engineParameters_[EP_VSYNC]=false;
+    }
+}
+
 
 void SceneLoader::Start()
 {
@@ -95,6 +139,13 @@ void SceneLoader::Start()
 
     URHO3D_LOGINFOF("[SceneLoader] Current dir:%s",fs->GetCurrentDir().CString());
 
+    NetworkConfig networkConfig = BlenderNetwork::GetDefaultConfig();
+    String recordPath;
+    String replayPath;
+    float replaySpeed = 1.0f;
+    float benchmarkDuration = 3.0f;
+    StringVector clients;
+
     auto args = GetArguments();
     for (unsigned i=0;i < args.Size(); i++){
         String arg = args[i];
@@ -126,9 +177,122 @@ void SceneLoader::Start()
             i++;
             URHO3D_LOGINFOF("[SceneLoader] customui: %s",customUI.CString());
         }
+        else if (args[i]=="--readbackbuffers" && (i+1)<args.Size()){
+            settings.readbackBuffers = Max(ToUInt(args[i+1]),1U);
+            i++;
+            URHO3D_LOGINFOF("[SceneLoader] readback-buffers: %u",settings.readbackBuffers);
+        }
+        else if (args[i]=="--noidle"){
+            idleMode_ = false;
+        }
+        else if (args[i]=="--idlewake" && (i+1)<args.Size()){
+            // seconds
+            idleWakeInterval_ = Max(ToFloat(args[i+1]),0.001f);
+            i++;
+        }
+        else if (args[i]=="--atlas"){
+            // default for clients that don't choose
+            settings.atlas = true;
+            URHO3D_LOGINFO("[SceneLoader] view atlas: on");
+        }
+        // zeromq endpoints, e.g. tcp://localhost:5560, ipc:///tmp/blender-in or inproc://blender-in
+        else if (args[i]=="--inendpoint" && (i+1)<args.Size()){
+            networkConfig.inEndpoint_ = args[i+1];
+            i++;
+        }
+        else if (args[i]=="--outendpoint" && (i+1)<args.Size()){
+            networkConfig.outEndpoint_ = args[i+1];
+            i++;
+        }
+        else if (args[i]=="--viewendpoint" && (i+1)<args.Size()){
+            // separate subscription for the camera updates, coalesced per client and view
+            networkConfig.viewEndpoint_ = args[i+1];
+            i++;
+        }
+        else if (args[i]=="--hwm" && (i+1)<args.Size()){
+            networkConfig.receiveHWM_ = networkConfig.sendHWM_ = ToInt(args[i+1]);
+            i++;
+        }
+        else if (args[i]=="--sndbuf" && (i+1)<args.Size()){
+            networkConfig.sendBuffer_ = ToInt(args[i+1]);
+            i++;
+        }
+        else if (args[i]=="--rcvbuf" && (i+1)<args.Size()){
+            networkConfig.receiveBuffer_ = ToInt(args[i+1]);
+            i++;
+        }
+        else if (args[i]=="--clients" && (i+1)<args.Size()){
+            // ';' separated client ids this runtime serves (default: every blender instance)
+            clients = args[i+1].Split(';');
+            i++;
+            URHO3D_LOGINFOF("[SceneLoader] clients: %s",args[i].CString());
+        }
+        // session log of everything blender sent, see SessionRecorder
+        else if (args[i]=="--record" && (i+1)<args.Size()){
+            recordPath = args[i+1];
+            i++;
+        }
+        else if (args[i]=="--replay" && (i+1)<args.Size()){
+            replayPath = args[i+1];
+            i++;
+        }
+        else if (args[i]=="--replayspeed" && (i+1)<args.Size()){
+            // 1 is the recorded timing, 0 as fast as possible
+            replaySpeed = ToFloat(args[i+1]);
+            i++;
+        }
+        else if (args[i]=="--replayexit"){
+            // give the last frames time to render and be sent
+            replayExitDelay_ = 1.0f;
+        }
+        // end to end benchmark with an in-process client, see BenchmarkClient
+        else if (args[i]=="--benchmark" && (i+1)<args.Size()){
+            benchmarkPath_ = args[i+1];
+            i++;
+        }
+        else if (args[i]=="--benchmarkduration" && (i+1)<args.Size()){
+            // seconds per configuration
+            benchmarkDuration = ToFloat(args[i+1]);
+            i++;
+        }
+    }
+
+    if (!benchmarkPath_.Empty()){
+        networkConfig.inEndpoint_ = BenchmarkClient::IN_ENDPOINT;
+        networkConfig.outEndpoint_ = BenchmarkClient::OUT_ENDPOINT;
+        networkConfig.viewEndpoint_.Clear();
+        // measure what the pipeline can do, not the frame limiter
+        engine_->SetMaxFps(0);
+        engine_->SetMaxInactiveFps(0);
+    }
+
+    if (!replayPath.Empty()){
+        // the replayer takes blender's place, the pub socket runs in our zeromq context
+        networkConfig.inEndpoint_ = "inproc://blender-replay";
+        networkConfig.viewEndpoint_.Clear();
+    }
+
+    BlenderNetwork* blenderNetwork = GetSubsystem<BlenderNetwork>();
+    blenderNetwork->InitNetwork(networkConfig,clients);
+
+    if (!recordPath.Empty()){
+        blenderNetwork->StartRecording(recordPath);
+    }
+    if (!replayPath.Empty()){
+        replayer_ = new SessionReplayer(context_,blenderNetwork->GetZMQContext());
+        if (!replayer_->Start(replayPath,networkConfig.inEndpoint_,replaySpeed)){
+            replayer_.Reset();
+        }
+    }
+
+    if (serverMode_){
+        // logo, console and debug hud would render into a window nobody sees
+        SDL_HideWindow(GetSubsystem<Graphics>()->GetWindow());
+        URHO3D_LOGINFO("[SceneLoader] server mode: rendering the views only");
+    } else {
+        // Execute base class startup
+        Sample::Start();
     }
-    // Execute base class startup
-    Sample::Start();
 
     // Create the scene content
     bool foundScene = CreateScene();
@@ -136,7 +300,9 @@ void SceneLoader::Start()
         return;
 
     // Create the UI content
-    CreateUI();
+    if (!serverMode_){
+        CreateUI();
+    }
 
     // Setup the viewport for displaying the scene
     SetupViewport();
@@ -145,15 +311,35 @@ void SceneLoader::Start()
     SubscribeToEvents();
 
     // Set the mouse mode to use in the sample
-    Sample::InitMouseMode(MM_FREE);
+    if (!serverMode_){
+        Sample::InitMouseMode(MM_FREE);
+    }
 
     ExportComponents(exportPath);
 
+    if (!benchmarkPath_.Empty()){
+        benchmark_ = new BenchmarkClient(context_,blenderNetwork->GetZMQContext());
+        benchmark_->AddDefaultSweep();
+        benchmark_->SetRunDuration(benchmarkDuration);
+        if (!benchmark_->Start()){
+            engine_->Exit();
+        }
+    }
 
 }
 
 void SceneLoader::Stop()
 {
+    for (ViewRenderer* view : viewRenderers.Values()){
+        if (view->GetLatencyStats().GetTotal().GetCount()){
+            URHO3D_LOGINFOF("view %i latency: %s",view->GetId(),view->GetLatencyStats().ToString().CString());
+        }
+    }
+
+    // the replayer's and benchmark's sockets have to be closed before the zeromq context
+    replayer_.Reset();
+    benchmark_.Reset();
+
     BlenderNetwork* blenderNetwork = GetSubsystem<BlenderNetwork>();
     if (blenderNetwork){
         blenderNetwork->Close();
@@ -204,15 +390,21 @@ bool SceneLoader::CreateScene()
 {
     ResourceCache* cache = GetSubsystem<ResourceCache>();
 
-    scene_ = new Scene(context_);
-    SharedPtr<File> file = cache->GetFile("Scenes/"+sceneName);
-    if (file.Null()){
-        URHO3D_LOGERROR("SceneLoader could not find 'Scenes/Scene.xml' in its resource-path");
-        engine_->Exit();
-        return false;
+    if (!benchmarkPath_.Empty()){
+        // the benchmark doesn't need exported content, its views show a procedural scene
+        scene_ = BenchmarkClient::CreateScene(context_);
+        scenes_["Scenes/"+String(BenchmarkClient::SCENE_NAME)+".xml"] = scene_;
+    } else {
+        scene_ = new Scene(context_);
+        SharedPtr<File> file = cache->GetFile("Scenes/"+sceneName);
+        if (file.Null()){
+            URHO3D_LOGERROR("SceneLoader could not find 'Scenes/Scene.xml' in its resource-path");
+            engine_->Exit();
+            return false;
+        }
+        cache->SetAutoReloadResources(true);
+        scene_->LoadXML(*file);
     }
-    cache->SetAutoReloadResources(true);
-    scene_->LoadXML(*file);
     Globals::instance()->scene=scene_;
 
     // Create the camera (not included in the scene file)
@@ -340,7 +532,12 @@ void SceneLoader::SetupViewport()
 
     // Set up a viewport to the Renderer subsystem so that the 3D scene can be seen
     SharedPtr<Viewport> viewport(new Viewport(context_, scene_, cameraNode_->GetComponent<Camera>()));
-    renderer->SetViewport(0, viewport);
+    if (serverMode_){
+        // the viewport only provides the render paths of the views
+        renderer->SetNumViewports(0);
+    } else {
+        renderer->SetViewport(0, viewport);
+    }
 
     renderer->SetHDRRendering(true);
 
@@ -362,12 +559,20 @@ void SceneLoader::SubscribeToEvents()
 {
     // Subscribe HandleUpdate() function for camera motion
     SubscribeToEvent(E_UPDATE, URHO3D_HANDLER(SceneLoader, HandleUpdate));
+    SubscribeToEvent(E_POSTUPDATE, URHO3D_HANDLER(SceneLoader, HandlePostUpdate));
+    SubscribeToEvent(E_ENDFRAME, URHO3D_HANDLER(SceneLoader, HandleEndFrame));
     SubscribeToEvent(E_POSTRENDERUPDATE, URHO3D_HANDLER(SceneLoader, HandlePostRenderUpdate));
     using namespace FileChanged;
     SubscribeToEvent(E_FILECHANGED, URHO3D_HANDLER(SceneLoader, HandleFileChanged));
     SubscribeToEvent(E_ENDALLVIEWSRENDER, URHO3D_HANDLER(SceneLoader, HandleAfterRender));
-    using namespace BlenderConnect;
-    SubscribeToEvent(E_BLENDER_MSG, URHO3D_HANDLER(SceneLoader,HandleBlenderMSG));
+    SubscribeToEvent(E_BEGINVIEWRENDER, URHO3D_HANDLER(SceneLoader, HandleBeginViewRender));
+    SubscribeToEvent(E_ENDVIEWRENDER, URHO3D_HANDLER(SceneLoader, HandleEndViewRender));
+
+    BlenderNetwork* bN = GetSubsystem<BlenderNetwork>();
+    bN->RegisterHandler("blender","view","bin",URHO3D_BLENDER_HANDLER(SceneLoader,HandleViewMSG));
+    bN->RegisterHandler("blender","data_change","json",URHO3D_BLENDER_HANDLER(SceneLoader,HandleDataChangeMSG));
+    bN->RegisterHandler("blender","settings","json",URHO3D_BLENDER_HANDLER(SceneLoader,HandleSettingsMSG));
+    bN->RegisterHandler("blender","ack","json",URHO3D_BLENDER_HANDLER(SceneLoader,HandleAckMSG));
 
 }
 
@@ -449,7 +654,11 @@ void SceneLoader::HandleFileChanged(StringHash eventType, VariantMap& eventData)
             scene->LoadXML(*file);
 
             EnsureLight((scene));
-            UpdateAllViewRenderers(scene);
+            // the reload shows up as node and component changes, only the views that see them are rendered
+            PhysicsWorld* pw = scene->GetComponent<PhysicsWorld>();
+            if (pw){
+                pw->SetUpdateEnabled(settings.activatePhysics);
+            }
         }
     }
     if (resName.EndsWith("png") || resName.EndsWith("jpg") || resName.EndsWith("dds")){
@@ -469,48 +678,110 @@ void SceneLoader::HandleFileChanged(StringHash eventType, VariantMap& eventData)
 }
 
 
-void SceneLoader::UpdateAllViewRenderers(Scene* scene)
+void SceneLoader::FlushDirtyViews()
 {
+    for (SceneChangeTracker* tracker : sceneTrackers_.Values()){
+        if (!tracker->HasChanges()){
+            continue;
+        }
+        changedBounds_.Clear();
+        tracker->FlushChanges(changedBounds_);
+        for (ViewRenderer* view : viewRenderers.Values()){
+            if (view->GetScene() != tracker->GetTrackedScene() || view->GetDirtyFlags()){
+                continue;
+            }
+            const Frustum& frustum = view->GetCamera()->GetFrustum();
+            for (const BoundingBox& bounds : changedBounds_){
+                if (frustum.IsInsideFast(bounds) != OUTSIDE){
+                    view->MarkDirty(VIEWDIRTY_SCENE);
+                    break;
+                }
+            }
+        }
+    }
+
     for (ViewRenderer* view : viewRenderers.Values()){
-        if (!scene || view->GetScene() == scene){
-            view->RequestRender();
+        if (view->GetDirtyFlags()){
+            view->ClearDirty();
             UpdateViewRenderer(view);
-            PhysicsWorld* pw = view->GetScene()->GetComponent<PhysicsWorld>();
-            pw->SetUpdateEnabled(settings.activatePhysics);
         }
     }
 }
 
+void SceneLoader::ReserveFrameSlots()
+{
+    HashMap<StringHash,unsigned> numSlots;
+    for (ViewRenderer* view : viewRenderers.Values()){
+        const RenderSettings& viewSettings = view->GetSettings();
+        // without credit a view has at most as many frames on the way as it has frame buffers
+        numSlots[view->GetKey().client_] += viewSettings.maxFramesInFlight ? viewSettings.maxFramesInFlight : viewSettings.readbackBuffers + 2;
+    }
+    BlenderNetwork* bN = GetSubsystem<BlenderNetwork>();
+    for (HashMap<StringHash,unsigned>::ConstIterator it = numSlots.Begin(); it != numSlots.End(); ++it){
+        bN->ReserveFrameSlots(it->first_,it->second_);
+    }
+}
+
+void SceneLoader::TrackScene(Scene* scene)
+{
+    if (scene && !sceneTrackers_.Contains(scene)){
+        sceneTrackers_[scene] = new SceneChangeTracker(context_,scene);
+    }
+}
+
 void SceneLoader::ChangeFov(float delta)
 {
     Camera* cam = nullptr;
     if (currentViewRenderer){
         Renderer* renderer = GetSubsystem<Renderer>();
         Viewport* viewport = renderer->GetViewport(0);
-        cam = viewport->GetCamera();
+        cam = viewport ? viewport->GetCamera() : nullptr;
     } else {
         cam = currentViewRenderer->GetCamera();
     }
+    if (!cam){
+        return;
+    }
     float fov = cam->GetFov();
     fov = fov + delta;
     cam->SetFov(fov);
 }
 
-void SceneLoader::HandleBlenderMSG(StringHash eventType, VariantMap &eventData)
+void SceneLoader::HandleViewMSG(BlenderMessage& message)
 {
-    using namespace BlenderConnect;
-    auto topic = eventData[P_TOPIC].GetString();
-    auto subtype = eventData[P_SUBTYPE].GetString();
-    auto datatype = eventData[P_DATATYPE].GetString();
-    auto d = eventData[P_DATA];
-    JSONObject data  =  d.GetCustom<JSONObject>();
-    //*static_cast<JSONObject*>(eventData[P_DATA].GetVoidPtr());
-    if (subtype == "data_change"){
-        HandleRenderRequestFromBlender(data);
+    // navigation path: decoded straight from the zeromq frame, no json involved
+    ViewMessage view;
+    if (!view.Read(message.GetData(),message.GetDataSize())){
+        URHO3D_LOGERRORF("invalid view message (size:%i)",message.GetDataSize());
+        return;
     }
-    else if (subtype == "settings") {
-        HandleSettingsRequestFromBlender(data);
+    LatencyTrace trace;
+    trace.inputSeq_ = view.inputSeq_;
+    trace.clientTime_ = view.clientTime_;
+    trace.stamps_[STAGE_RECEIVE] = message.GetReceiveTime();
+    HandleViewUpdateFromBlender(message.GetClientId(),view,trace);
+}
+
+void SceneLoader::HandleDataChangeMSG(BlenderMessage& message)
+{
+    const JSONObject& json = message.GetJSON();
+    LatencyTrace trace;
+    if (json.Contains("input_seq")){
+        trace.inputSeq_ = json["input_seq"]->GetUInt();
+        trace.clientTime_ = json.Contains("client_time") ? (unsigned long long)json["client_time"]->GetDouble() : 0;
+        trace.stamps_[STAGE_RECEIVE] = message.GetReceiveTime();
     }
+    HandleRenderRequestFromBlender(message.GetClient(),json,trace);
+}
+
+void SceneLoader::HandleSettingsMSG(BlenderMessage& message)
+{
+    HandleSettingsRequestFromBlender(message.GetClient(),message.GetJSON());
+}
+
+void SceneLoader::HandleAckMSG(BlenderMessage& message)
+{
+    HandleAckFromBlender(message.GetClientId(),message.GetJSON());
 }
 
 void SceneLoader::HandleUpdate(StringHash eventType, VariantMap& eventData)
@@ -520,8 +791,33 @@ void SceneLoader::HandleUpdate(StringHash eventType, VariantMap& eventData)
     // Take the frame time step, which is stored as a float
     float timeStep = eventData[P_TIMESTEP].GetFloat();
 
+    if (replayer_ && replayer_->IsFinished() && replayExitDelay_ >= 0.0f){
+        replayExitDelay_ -= timeStep;
+        if (replayExitDelay_ < 0.0f){
+            URHO3D_LOGINFO("[SceneLoader] replay finished, exiting");
+            engine_->Exit();
+            return;
+        }
+    }
+
+    // frees the textures of sizes no view used for a while
+    renderTargets_->Update();
+
+    if (benchmark_ && benchmark_->IsFinished()){
+        JSONFile results(context_);
+        benchmark_->WriteResults(results.GetRoot());
+        if (results.SaveFile(benchmarkPath_)){
+            URHO3D_LOGINFOF("[SceneLoader] benchmark results written to %s",benchmarkPath_.CString());
+        } else {
+            URHO3D_LOGERRORF("[SceneLoader] could not write benchmark results to %s",benchmarkPath_.CString());
+        }
+        benchmark_.Reset();
+        engine_->Exit();
+        return;
+    }
+
     // Move the camera, scale movement with time step
-    if (currentCamId==0){
+    if (currentCamId==0 && !serverMode_){
         MoveCamera(timeStep);
     }
 
@@ -539,7 +835,9 @@ void SceneLoader::HandleUpdate(StringHash eventType, VariantMap& eventData)
         }
         Renderer* renderer = GetSubsystem<Renderer>();
         Viewport* viewport = renderer->GetViewport(0);
-        viewport->SetCamera(cameras[currentCamId]);
+        if (viewport){
+            viewport->SetCamera(cameras[currentCamId]);
+        }
     }
     else if (input->GetKeyPress(KEY_F12)){
         if (!editorVisible_){
@@ -576,15 +874,14 @@ void SceneLoader::HandleUpdate(StringHash eventType, VariantMap& eventData)
         currentRenderPathDefault = !currentRenderPathDefault;
         auto* renderer = GetSubsystem<Renderer>();
         for (auto viewrenderer : viewRenderers.Values()){
-            Viewport* viewport = viewrenderer->GetViewport();
             if (currentRenderPathDefault){
-                viewport->SetRenderPath(defaultRenderpath);
+                viewrenderer->SetRenderPath(defaultRenderpath);
                 renderer->SetHDRRendering(false);
                 URHO3D_LOGINFO("Set Renderpath: default");
             }
             else{
                 URHO3D_LOGINFO("Set Renderpath: PBR");
-                viewport->SetRenderPath(pbrRenderpath);
+                viewrenderer->SetRenderPath(pbrRenderpath);
                 renderer->SetHDRRendering(true);
             }
 
@@ -596,6 +893,18 @@ void SceneLoader::HandleUpdate(StringHash eventType, VariantMap& eventData)
         updatedCamera = false;
     }
 
+    for (ViewRenderer* view : viewRenderers.Values()){
+        // views that stopped moving get a lossless version of their last lossy frame
+        if (view->NeedsRefinement() && !view->IsInteracting()){
+            view->SetNeedsRefinement(false);
+            UpdateViewRenderer(view);
+        }
+        // render what was skipped while blender was behind
+        else if (view->IsRenderPending() && view->HasCredit()){
+            UpdateViewRenderer(view);
+        }
+    }
+
     if (rtRenderRequested){
         if (screenshotTimer > 0){
             screenshotTimer-=timeStep;
@@ -611,6 +920,95 @@ void SceneLoader::HandlePostRenderUpdate(StringHash eventType, VariantMap& event
 }
 
 
+void SceneLoader::HandlePostUpdate(StringHash eventType, VariantMap& eventData)
+{
+    // camera, settings and scene changes of this frame (scene updates ran in E_UPDATE)
+    FlushDirtyViews();
+
+    // all views of this frame are known, the atlases have to be laid out before the renderer
+    // collects the surfaces to update (E_RENDERUPDATE)
+    for (ViewRenderer* view : updatedRenderers){
+        if (view->IsAtlasMode()){
+            GetViewAtlas(view)->Add(view);
+        }
+    }
+
+    PODVector<ViewRenderer*> rejected;
+    for (ViewAtlas* atlas : atlases_.Values()){
+        atlas->Render(rejected);
+    }
+    for (ViewRenderer* view : rejected){
+        URHO3D_LOGWARNINGF("view %i does not fit into the atlas, rendering it next frame",view->GetId());
+        updatedRenderers.Erase(view);
+        view->SetRenderPending(true);
+    }
+}
+
+void SceneLoader::HandleEndFrame(StringHash eventType, VariantMap& eventData)
+{
+    if (!idleMode_){
+        return;
+    }
+    float now = GetSubsystem<Time>()->GetElapsedTime();
+    if (HasPendingWork()){
+        lastActivityTime_ = now;
+        return;
+    }
+    if (now - lastActivityTime_ < idleDelay_){
+        return;
+    }
+    // the network thread wakes us as soon as blender sends something. the file watcher has no
+    // wakeup, its changes are picked up after the interval
+    GetSubsystem<BlenderNetwork>()->WaitForMessages((unsigned)(idleWakeInterval_ * 1000.0f));
+}
+
+bool SceneLoader::HasPendingWork()
+{
+    // the user is working in the window
+    if (GetSubsystem<Input>()->HasFocus()){
+        return true;
+    }
+    if ((replayer_ && !replayer_->IsFinished()) || benchmark_ || !updatedRenderers.Empty() || settings.activatePhysics){
+        return true;
+    }
+    for (ViewRenderer* view : viewRenderers.Values()){
+        // unsent frames, skipped renders and lossy frames waiting for their refinement
+        if (!view->GetReadback()->IsEmpty() || view->IsRenderPending() || view->NeedsRefinement()){
+            return true;
+        }
+    }
+    for (ViewAtlas* atlas : atlases_.Values()){
+        if (!atlas->GetReadback()->IsEmpty()){
+            return true;
+        }
+    }
+    for (Scene* scene : scenes_.Values()){
+        if (IsSceneActive(scene)){
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SceneLoader::IsSceneActive(Scene* scene)
+{
+    if (!scene->IsUpdateEnabled()){
+        return false;
+    }
+    PhysicsWorld* physicsWorld = scene->GetComponent<PhysicsWorld>();
+    if (physicsWorld && physicsWorld->IsUpdateEnabled()){
+        return true;
+    }
+    PODVector<AnimationController*> controllers;
+    scene->GetComponents<AnimationController>(controllers,true);
+    for (AnimationController* controller : controllers){
+        if (controller->IsEnabledEffective() && !controller->GetAnimations().Empty()){
+            return true;
+        }
+    }
+    return false;
+}
+
 /*void SceneLoader::CreateScreenshot()
 {
     if (additionalResourcePath=="") return;
@@ -777,16 +1175,36 @@ Vector3 JSON2Vec3(const JSONObject& v){
 }
 
 
-ViewRenderer* SceneLoader::GetViewRenderer(int viewId)
+ViewRenderer* SceneLoader::GetViewRenderer(const ViewKey& key)
 {
-    if (viewRenderers.Contains(viewId)){
-        ViewRenderer* result = viewRenderers[viewId];
+    if (viewRenderers.Contains(key)){
+        ViewRenderer* result = viewRenderers[key];
         return result;
     } else {
         return nullptr;
     }
 }
 
+RenderSettings& SceneLoader::GetClientSettings(StringHash client)
+{
+    HashMap<StringHash,RenderSettings>::Iterator it = clientSettings_.Find(client);
+    if (it == clientSettings_.End()){
+        it = clientSettings_.Insert(MakePair(client,settings));
+    }
+    return it->second_;
+}
+
+ViewAtlas* SceneLoader::GetViewAtlas(const ViewRenderer* view)
+{
+    StringHash client = view->GetKey().client_;
+    HashMap<StringHash,SharedPtr<ViewAtlas> >::Iterator it = atlases_.Find(client);
+    if (it == atlases_.End()){
+        ViewAtlas* atlas = new ViewAtlas(context_,renderTargets_,view->GetClient(),GetClientSettings(client).readbackBuffers);
+        it = atlases_.Insert(MakePair(client,SharedPtr<ViewAtlas>(atlas)));
+    }
+    return it->second_;
+}
+
 Scene* SceneLoader::GetScene(const String &sceneName)
 {
     auto sceneResourceName = "Scenes/"+sceneName+".xml";
@@ -808,7 +1226,9 @@ Scene* SceneLoader::GetScene(const String &sceneName)
 
         // Set up a viewport to the Renderer subsystem so that the 3D scene can be seen
         SharedPtr<Viewport> viewport(new Viewport(context_, scene_, cameraNode_->GetComponent<Camera>()));
-        renderer->GetViewport(0)->SetScene(newScene);
+        if (renderer->GetViewport(0)){
+            renderer->GetViewport(0)->SetScene(newScene);
+        }
     }
     scenes_[sceneResourceName]=newScene;
 
@@ -839,25 +1259,150 @@ Matrix4 JSON2Matrix(const JSONArray& mat4Vecs)
     return vmat;
 }
 
-void SceneLoader::HandleSettingsRequestFromBlender(const JSONObject &json)
+void SceneLoader::HandleSettingsRequestFromBlender(const String& client, const JSONObject &json)
 {
     if (!json.Contains("show_physics")) {
         URHO3D_LOGERROR("could not process blender settings!");
         return;
     }
 
+    // physics is part of the shared scenes, the last client wins
+    bool physicsChanged = settings.showPhysics != json["show_physics"]->GetBool()
+            || settings.showPhysicsDepth != json["show_physics_depth"]->GetBool()
+            || settings.activatePhysics != json["activate_physics"]->GetBool();
     settings.showPhysics = json["show_physics"]->GetBool();
     settings.showPhysicsDepth = json["show_physics_depth"]->GetBool();
     settings.activatePhysics = json["activate_physics"]->GetBool();
 
-    UpdateAllViewRenderers();
+    // everything else only affects the views of this client
+    RenderSettings& clientSettings = GetClientSettings(StringHash(client));
+    bool atlas = clientSettings.atlas;
+    clientSettings.showPhysics = settings.showPhysics;
+    clientSettings.showPhysicsDepth = settings.showPhysicsDepth;
+    clientSettings.activatePhysics = settings.activatePhysics;
+
+    if (json.Contains("delta_tiles")){
+        bool deltaTiles = json["delta_tiles"]->GetBool();
+        if (deltaTiles && !clientSettings.deltaTiles){
+            // blender has no reference frame yet
+            for (ViewRenderer* view : viewRenderers.Values()){
+                if (view->GetClient() == client){
+                    view->GetTileEncoder().RequestKeyframe();
+                }
+            }
+        }
+        clientSettings.deltaTiles = deltaTiles;
+    }
+    if (json.Contains("tile_size")){
+        clientSettings.tileSize = Max(json["tile_size"]->GetUInt(),1U);
+    }
+    if (json.Contains("keyframe_interval")){
+        clientSettings.keyframeInterval = json["keyframe_interval"]->GetUInt();
+    }
+    if (json.Contains("codec")){
+        clientSettings.codec = FrameCodec::FromString(json["codec"]->GetString());
+    }
+    if (json.Contains("transport")){
+        BlenderNetwork* bN = GetSubsystem<BlenderNetwork>();
+        bN->SetFrameTransport(StringHash(client),json["transport"]->GetString() == "shm" ? TRANSPORT_SHM : TRANSPORT_TCP);
+    }
+    if (json.Contains("max_frames_in_flight")){
+        clientSettings.maxFramesInFlight = json["max_frames_in_flight"]->GetUInt();
+        ReserveFrameSlots();
+    }
+    if (json.Contains("ack_timeout")){
+        clientSettings.ackTimeout = json["ack_timeout"]->GetFloat();
+    }
+    if (json.Contains("binary_header")){
+        clientSettings.binaryHeader = json["binary_header"]->GetBool();
+    }
+    if (json.Contains("progressive")){
+        clientSettings.progressive = json["progressive"]->GetBool();
+    }
+    if (json.Contains("idle_time")){
+        clientSettings.idleTime = json["idle_time"]->GetFloat();
+    }
+    if (json.Contains("dynamic_resolution")){
+        clientSettings.dynamicResolution = json["dynamic_resolution"]->GetBool();
+    }
+    if (json.Contains("target_frame_time")){
+        // milliseconds
+        clientSettings.targetFrameTime = json["target_frame_time"]->GetFloat() / 1000.0f;
+    }
+    if (json.Contains("min_scale")){
+        clientSettings.minScale = json["min_scale"]->GetFloat();
+    }
+    if (json.Contains("metrics_interval")){
+        // seconds, 0 = off
+        metrics_->SetInterval(json["metrics_interval"]->GetFloat());
+    }
+    if (json.Contains("atlas")){
+        // the views of this client are rendered side by side and sent as one message
+        clientSettings.atlas = json["atlas"]->GetBool();
+    }
+    if (json.Contains("render_target_timeout")){
+        // seconds an unused render texture is kept for views that resize back to its size
+        renderTargets_->SetIdleTimeout(json["render_target_timeout"]->GetFloat());
+    }
+
+    // most settings only change how the next frames are sent. the physics debug drawing is visible
+    // in all views, the atlas moves the views of this client to another message
+    for (ViewRenderer* view : viewRenderers.Values()){
+        PhysicsWorld* pw = view->GetScene()->GetComponent<PhysicsWorld>();
+        if (pw){
+            pw->SetUpdateEnabled(settings.activatePhysics);
+        }
+        if (physicsChanged || (atlas != clientSettings.atlas && view->GetClient() == client)){
+            view->MarkDirty(VIEWDIRTY_SETTINGS);
+        }
+    }
+}
+
+void SceneLoader::HandleAckFromBlender(StringHash client, const JSONObject &json)
+{
+    if (!json.Contains("view_id") || !json.Contains("seq")){
+        URHO3D_LOGERROR("could not process blender ack!");
+        return;
+    }
+    ViewRenderer* viewRenderer = GetViewRenderer(ViewKey(client,json["view_id"]->GetInt()));
+    if (viewRenderer){
+        viewRenderer->Acknowledge(json["seq"]->GetUInt());
+        // blender saw a gap in the frame sequence (dropped by a high water mark or the send queue), the
+        // tiles it has are out of sync. the acks are cumulative, so only blender can tell
+        bool resync = json.Contains("keyframe") && json["keyframe"]->GetBool();
+        if (resync){
+            viewRenderer->GetTileEncoder().RequestKeyframe();
+        }
+        if (resync || (viewRenderer->IsRenderPending() && viewRenderer->HasCredit())){
+            UpdateViewRenderer(viewRenderer);
+        }
+    }
+}
+
+void SceneLoader::HandleViewUpdateFromBlender(StringHash client, const ViewMessage& view, LatencyTrace& trace)
+{
+    ViewRenderer* viewRenderer = GetViewRenderer(ViewKey(client,view.viewId_));
+    if (!viewRenderer){
+        // creating a view needs the scene name, that only comes with the json data_change
+        URHO3D_LOGWARNINGF("view message for unknown view %i",view.viewId_);
+        return;
+    }
+
+    if (view.flags_ & VIEWFLAG_RESOLUTION){
+        viewRenderer->SetSize(view.width_,view.height_,view.fov_);
+    }
+    viewRenderer->SetViewData((view.flags_ & VIEWFLAG_ORTHO)!=0,view.position_,view.direction_,view.up_,view.orthoSize_,view.fov_);
+    trace.Stamp(STAGE_APPLY);
+    viewRenderer->SetInputTrace(trace);
+    viewRenderer->NotifyViewChanged();
 }
 
-void SceneLoader::HandleRenderRequestFromBlender(const JSONObject &json)
+void SceneLoader::HandleRenderRequestFromBlender(const String& client, const JSONObject &json, LatencyTrace& trace)
 {
     int viewId = json["view_id"]->GetInt();
+    ViewKey key(StringHash(client),viewId);
 
-    ViewRenderer* viewRenderer = GetViewRenderer(viewId);
+    ViewRenderer* viewRenderer = GetViewRenderer(key);
 
     int width = 100;
     int height = 100;
@@ -872,22 +1417,29 @@ void SceneLoader::HandleRenderRequestFromBlender(const JSONObject &json)
         fov = json["fov"]->GetFloat();
 
         newRenderer = true;
+        // scenes (and the resources in the cache) are shared by all clients
         String sceneName = json["scene_name"]->GetString();
         Scene* scene = GetScene(sceneName);
-        viewRenderer = new ViewRenderer(context_,settings,viewId,scene,width,height,fov);
-        viewRenderers[viewId] = viewRenderer;
-        UpdateViewRenderer(viewRenderer);
+        viewRenderer = new ViewRenderer(context_,GetClientSettings(key.client_),renderTargets_,client,viewId,scene,width,height,fov);
+        viewRenderers[key] = viewRenderer;
+        TrackScene(scene);
+        ReserveFrameSlots();
     }
 
     if (!viewRenderer) return;
 
+    if (json.Contains("codec")){
+        // codec negotiated for this view only
+        viewRenderer->SetCodec(FrameCodec::FromString(json["codec"]->GetString()));
+    }
+
     if (!newRenderer && json.Contains("resolution")){
         auto resolution = json["resolution"]->GetObject();
         width = resolution["width"].GetInt();
         height = resolution["height"].GetInt();
         fov = json["fov"]->GetFloat();
         viewRenderer->SetSize(width,height,fov);
-        UpdateViewRenderer(viewRenderer);
+        viewRenderer->NotifyViewChanged();
     }
 
     if (json.Contains("view_matrix")){
@@ -923,9 +1475,10 @@ void SceneLoader::HandleRenderRequestFromBlender(const JSONObject &json)
 
         bool isOrthoMode = perspectiveType == "ORTHO";
         viewRenderer->SetViewData(isOrthoMode,pos,dir,up,view_distance,fov);
+        trace.Stamp(STAGE_APPLY);
+        viewRenderer->SetInputTrace(trace);
+        viewRenderer->NotifyViewChanged();
 
-
-        UpdateViewRenderer(viewRenderer);
         /*JSONArray matrix = json["perspective_matrix"]->GetArray();
         Vector4 v1 = JSON2Vec4(matrix[0].GetObject());
         Vector4 v2 = JSON2Vec4(matrix[1].GetObject());
@@ -977,32 +1530,49 @@ void SceneLoader::HandleRenderRequestFromBlender(const JSONObject &json)
 
 void SceneLoader::HandleAfterRender(StringHash eventType, VariantMap& eventData)
 {
+    // only queue the copy of the views rendered this frame. the pixels are picked up as soon as
+    // the gpu is done with them (usually next frame) so we don't stall until the gpu finished rendering
     for (ViewRenderer* view : updatedRenderers){
         screenshotTimer = screenshotInterval;
         rtRenderRequested=false;
 
-        URHO3D_LOGINFO("AFTER RENDER");
-        auto rtTexture = view->GetRenderTexture();
-
-        int imageSize = rtTexture->GetDataSize(rtTexture->GetWidth(), rtTexture->GetHeight());
-        unsigned char* _ImageData = new unsigned char[imageSize];
-        rtTexture->GetData(0, _ImageData);
-
-        JSONObject json;
-        json["width"]=rtTexture->GetWidth();
-        json["height"]=rtTexture->GetHeight();
-        jsonfile_.GetRoot().Set("resolution",json);
-        jsonfile_.GetRoot().Set("fov",view->GetCamera()->GetFov());
-        jsonfile_.GetRoot().Set("initial-fov",view->fov_);
+        if (view->IsAtlasMode()){
+            // read back with the atlas below
+            continue;
+        }
+        FrameReadback* readback = view->GetReadback();
+        if (readback->IsFull()){
+            // all staging buffers in use => wait for the oldest one to make room
+            SendFinishedFrames(view,true);
+        }
+        view->QueueReadback();
+    }
+    updatedRenderers.Clear();
 
-        BlenderNetwork* bN = GetSubsystem<BlenderNetwork>();
-        bN->Send(view->GetNetId(),"draw",_ImageData,imageSize, jsonfile_.ToString());
+    for (ViewAtlas* atlas : atlases_.Values()){
+        if (atlas->IsEmpty()){
+            continue;
+        }
+        if (atlas->GetReadback()->IsFull()){
+            SendFinishedAtlasFrames(atlas,true);
+        }
+        atlas->QueueReadback();
+    }
 
-        //_pImage->SavePNG(additionalResourcePath+"/Screenshot"+String(view->GetId())+".png");
+    for (ViewRenderer* view : viewRenderers.Values()){
+        SendFinishedFrames(view);
+    }
+    for (ViewAtlas* atlas : atlases_.Values()){
+        SendFinishedAtlasFrames(atlas);
+    }
 
-        delete[] _ImageData;
+    metrics_->AddFrameTime(GetSubsystem<Time>()->GetTimeStep());
+    if (metrics_->IsDue()){
+        for (ViewRenderer* view : viewRenderers.Values()){
+            metrics_->AddView(view->GetClient(),view->GetId(),view->GetMetrics(),view->GetLatencyStats());
+        }
+        metrics_->Publish();
     }
-    updatedRenderers.Clear();
 
 //    if (rtRenderRequested && screenshotTimer <= 0 ){
 
@@ -1014,28 +1584,301 @@ void SceneLoader::HandleAfterRender(StringHash eventType, VariantMap& eventData)
 
 }
 
+void SceneLoader::SendFinishedFrames(ViewRenderer* view, bool wait)
+{
+    FrameReadback* readback = view->GetReadback();
+
+    FrameInfo info;
+    HiresTimer readTimer;
+    while (readback->IsReady(info,wait)){
+        // the pixels are written once into a pooled buffer that is handed to zeromq as is
+        FrameBuffer* frame = view->GetFramePool()->Acquire(info.dataSize_);
+        readback->Read(frame->data_);
+        if (info.trace_.IsValid()){
+            info.trace_.Stamp(STAGE_READBACK);
+        }
+
+        float readTime = readTimer.GetUSec(true) / 1000000.0f;
+        metrics_->AddReadbackTime(readTime);
+        view->AddFrameCost(readTime,info.scale_);
+
+        SendFrame(view,frame,info);
+
+        //_pImage->SavePNG(additionalResourcePath+"/Screenshot"+String(view->GetId())+".png");
+
+        // only block for one frame
+        wait = false;
+    }
+}
+
+void SceneLoader::SendFrame(ViewRenderer* view, FrameBuffer* frame, const FrameInfo& info)
+{
+    frameHeader_.Reset(info);
+    const RenderSettings& viewSettings = view->GetSettings();
+
+    FrameBufferPool* pool = view->GetFramePool();
+
+    // while the user navigates send a lossy frame. it gets replaced by a lossless one as soon as the view is idle
+    bool lossy = viewSettings.progressive && info.interactive_;
+    view->SetNeedsRefinement(lossy || info.scale_ < 1.0f);
+
+    if (lossy){
+        FrameBuffer* yuv = pool->Acquire(FrameCodec::GetYUVA420Size(info.width_,info.height_));
+        FrameCodec::ConvertToYUVA420(frame->data_,info.width_,info.height_,yuv->data_);
+        pool->Release(frame);
+        frame = yuv;
+        frameHeader_.format_ = FORMAT_YUVA420;
+        frameHeader_.flags_ |= FRAMEFLAG_PREVIEW;
+        // the tiles blender has are lossy now
+        view->GetTileEncoder().RequestKeyframe();
+    }
+    else if (viewSettings.deltaTiles){
+        TileDeltaEncoder& encoder = view->GetTileEncoder();
+        encoder.SetParameters(viewSettings.tileSize,viewSettings.keyframeInterval);
+
+        bool keyframe = encoder.Encode(frame->data_,info.width_,info.height_,changedTiles_);
+        if (keyframe){
+            frameHeader_.flags_ |= FRAMEFLAG_KEYFRAME;
+        } else {
+            FrameBuffer* packed = pool->Acquire(encoder.GetPackedSize(changedTiles_));
+            encoder.PackTiles(frame->data_,changedTiles_,packed->data_);
+            pool->Release(frame);
+            frame = packed;
+            frameHeader_.flags_ |= FRAMEFLAG_DELTA;
+            frameHeader_.SetTiles(encoder.GetTileSize(),changedTiles_);
+        }
+    }
+
+    unsigned rawSize = frame->size_;
+    FrameCodecType codec = view->GetCodec();
+    if (codec != CODEC_RAW){
+        FrameBuffer* encoded = pool->Acquire(FrameCodec::GetMaxEncodedSize(codec,rawSize));
+        unsigned size = frameCodec_.Encode(codec,frame->data_,rawSize,encoded->data_);
+        if (size && size < rawSize){
+            encoded->size_ = size;
+            pool->Release(frame);
+            frame = encoded;
+        } else {
+            // incompressible, send it as it is
+            pool->Release(encoded);
+            codec = CODEC_RAW;
+        }
+    }
+    frameHeader_.codec_ = codec;
+    frameHeader_.rawSize_ = rawSize;
+    frameHeader_.sendTimestamp_ = GetMonotonicUSec();
+
+    // the frame belongs to the network once it is handed over
+    unsigned frameSize = frame->size_;
+    BlenderNetwork* bN = GetSubsystem<BlenderNetwork>();
+    bool sent;
+    if (viewSettings.binaryHeader){
+        frameHeader_.WriteBinary(frameHeaderData_);
+        sent = bN->SendFrame(view->GetKey().client_,view->GetNetId(),"frame",frame,frameHeaderData_.Buffer(),frameHeaderData_.Size());
+    } else {
+        frameHeader_.WriteJSON(jsonfile_.GetRoot());
+        sent = bN->SendFrame(view->GetKey().client_,view->GetNetId(),"draw",frame, jsonfile_.ToString());
+    }
+    if (!sent){
+        // later delta frames would build on tiles blender never got, and a view that stopped
+        // changing would keep its stale image without another render
+        view->GetTileEncoder().RequestKeyframe();
+        view->SetRenderPending(true);
+        return;
+    }
+
+    ViewMetrics& metrics = view->GetMetrics();
+    metrics.framesSent_++;
+    metrics.bytesSent_ += frameSize;
+
+    if (info.trace_.IsValid()){
+        LatencyTrace trace = info.trace_;
+        trace.Stamp(STAGE_SENT);
+        view->GetLatencyStats().Add(trace);
+    }
+}
+
+
+void SceneLoader::SendFinishedAtlasFrames(ViewAtlas* atlas, bool wait)
+{
+    FrameInfo info;
+    Vector<AtlasEntry> layout;
+    HiresTimer readTimer;
+    while (FrameBuffer* frame = atlas->ReadFrame(info,layout,wait)){
+        float readTime = readTimer.GetUSec(true) / 1000000.0f;
+        metrics_->AddReadbackTime(readTime);
+        for (AtlasEntry& entry : layout){
+            if (entry.info_.trace_.IsValid()){
+                entry.info_.trace_.Stamp(STAGE_READBACK);
+            }
+            // the readback is shared, every view of the atlas has its own gpu timer
+            entry.view_->AddFrameCost(readTime / layout.Size(),entry.info_.scale_);
+        }
+
+        SendAtlasFrame(atlas,frame,info,layout);
+
+        // only block for one frame
+        wait = false;
+    }
+}
+
+void SceneLoader::SendAtlasFrame(ViewAtlas* atlas, FrameBuffer* frame, const FrameInfo& info, const Vector<AtlasEntry>& layout)
+{
+    // the views are cut out by blender, there is no progressive/delta path for them
+    JSONValue& meta = jsonfile_.GetRoot();
+    meta.Clear();
+
+    JSONObject resolution;
+    resolution["width"]=info.width_;
+    resolution["height"]=info.height_;
+    meta.Set("resolution",resolution);
+    meta.Set("seq",info.sequence_);
+
+    JSONArray views;
+    for (const AtlasEntry& entry : layout){
+        const FrameInfo& viewInfo = entry.info_;
+        JSONObject view;
+        view["view_id"]=entry.view_->GetId();
+        // rows of the rect are in the order of the pixel data, like the rows of a single frame
+        view["x"]=entry.readbackRect_.left_;
+        view["y"]=entry.readbackRect_.top_;
+        view["width"]=entry.readbackRect_.Width();
+        view["height"]=entry.readbackRect_.Height();
+        view["seq"]=viewInfo.sequence_;
+        view["fov"]=viewInfo.fov_;
+        view["initial-fov"]=viewInfo.initialFov_;
+        if (viewInfo.scale_ < 1.0f){
+            JSONObject viewSize;
+            viewSize["width"]=viewInfo.viewWidth_;
+            viewSize["height"]=viewInfo.viewHeight_;
+            view["view_resolution"]=viewSize;
+            view["scale"]=viewInfo.scale_;
+        }
+        if (viewInfo.trace_.IsValid()){
+            view["input_seq"]=viewInfo.trace_.inputSeq_;
+            view["client_time"]=(double)viewInfo.trace_.clientTime_;
+        }
+        views.Push(view);
+        // a lossless refinement would be the same frame again
+        entry.view_->SetNeedsRefinement(viewInfo.scale_ < 1.0f);
+    }
+    meta.Set("views",views);
+    meta.Set("format",FrameCodec::ToString(FORMAT_RGBA8));
+
+    FrameBufferPool* pool = atlas->GetFramePool();
+    unsigned rawSize = frame->size_;
+    FrameCodecType codec = layout.Front().view_->GetCodec();
+    if (codec != CODEC_RAW){
+        FrameBuffer* encoded = pool->Acquire(FrameCodec::GetMaxEncodedSize(codec,rawSize));
+        unsigned size = frameCodec_.Encode(codec,frame->data_,rawSize,encoded->data_);
+        if (size && size < rawSize){
+            encoded->size_ = size;
+            pool->Release(frame);
+            frame = encoded;
+        } else {
+            pool->Release(encoded);
+            codec = CODEC_RAW;
+        }
+    }
+    meta.Set("codec",FrameCodec::ToString(codec));
+    meta.Set("raw_size",rawSize);
+    meta.Set("send_time",(double)GetMonotonicUSec());
+
+    unsigned frameSize = frame->size_;
+    BlenderNetwork* bN = GetSubsystem<BlenderNetwork>();
+    if (!bN->SendFrame(atlas->GetClientId(),atlas->GetNetId(),"atlas",frame,jsonfile_.ToString())){
+        for (const AtlasEntry& entry : layout){
+            entry.view_->SetRenderPending(true);
+        }
+        return;
+    }
+
+    // the bytes are accounted to the views by their share of the atlas
+    for (const AtlasEntry& entry : layout){
+        ViewMetrics& metrics = entry.view_->GetMetrics();
+        metrics.framesSent_++;
+        metrics.bytesSent_ += (unsigned long long)frameSize * entry.readbackRect_.Width() * entry.readbackRect_.Height() / Max(info.width_ * info.height_,1);
+    }
+
+    for (const AtlasEntry& entry : layout){
+        if (entry.info_.trace_.IsValid()){
+            LatencyTrace trace = entry.info_.trace_;
+            trace.Stamp(STAGE_SENT);
+            entry.view_->GetLatencyStats().Add(trace);
+        }
+    }
+}
+
+
+void SceneLoader::HandleBeginViewRender(StringHash eventType, VariantMap& eventData)
+{
+    using namespace BeginViewRender;
+    // by camera, the views of an atlas share the texture
+    Camera* camera = static_cast<Camera*>(eventData[P_CAMERA].GetPtr());
+    for (ViewRenderer* view : viewRenderers.Values()){
+        if (view->GetCamera() == camera){
+            view->GetGpuTimer()->Begin(view->GetRenderScale());
+            break;
+        }
+    }
+}
+
+void SceneLoader::HandleEndViewRender(StringHash eventType, VariantMap& eventData)
+{
+    using namespace EndViewRender;
+    Camera* camera = static_cast<Camera*>(eventData[P_CAMERA].GetPtr());
+    for (ViewRenderer* view : viewRenderers.Values()){
+        if (view->GetCamera() == camera){
+            view->GetGpuTimer()->End();
+            break;
+        }
+    }
+}
 
 void SceneLoader::UpdateViewRenderer(ViewRenderer *renderer)
 {
+    // blender did not draw the frames in flight yet, rendering more would only queue up stale frames
+    if (!renderer->HasCredit()){
+        renderer->SetRenderPending(true);
+        return;
+    }
+    renderer->SetRenderPending(false);
+
+    // moving views are rendered with a resolution that holds the target frame time, idle ones with full resolution
+    float scale = 1.0f;
+    const RenderSettings& viewSettings = renderer->GetSettings();
+    if (viewSettings.dynamicResolution && renderer->IsInteracting()){
+        DynamicResolution& dynamicResolution = renderer->GetDynamicResolution();
+        dynamicResolution.SetParameters(viewSettings.targetFrameTime,viewSettings.minScale);
+        scale = dynamicResolution.UpdateScale();
+    }
+    renderer->SetRenderScale(scale);
+    renderer->SetAtlasMode(viewSettings.atlas);
+
     renderer->RequestRender();
     updatedRenderers.Insert(renderer);
 }
 
-ViewRenderer::ViewRenderer(Context* ctx,RenderSettings& settings_, int id, Scene* initialScene, int width,int height,float fov)
+ViewRenderer::ViewRenderer(Context* ctx,RenderSettings& settings_, RenderTargetPool* targetPool, const String& client, int id, Scene* initialScene, int width,int height,float fov)
     : fov_(fov),
+      client_(client),
       viewId_(id),
       width_(width),
       height_(height),
       orthosize_(0),
       orthoMode_(false),
       ctx_(ctx),
-      settings(settings_)
+      settings(settings_),
+      targetPool_(targetPool),
+      atlasMode_(false),
+      dirtyFlags_(0)
 {
 //    viewportCameraNode_ = new Node(ctx);
-    netId = "runtime-"+String(id);
+    // frames of a client are sent as 'runtime:<client>-<view id>', so a client subscribes to all of its views at once
+    netId = client.Empty() ? "runtime-"+String(id) : "runtime:"+client+"-"+String(id);
     viewportCameraNode_ = new Node(ctx);
     //viewportCameraNode_->SetName("Camera-"+String(id));
-    viewportCameraNode_ = initialScene->CreateChild("Camera-"+String(id));
+    viewportCameraNode_ = initialScene->CreateChild(client.Empty() ? "Camera-"+String(id) : "Camera-"+client+"-"+String(id));
     viewportCamera_ = viewportCameraNode_->CreateComponent<Camera>();
     viewportCamera_->SetFarClip(500.0f);
 //    viewportCamera_->SetPosition(Vector3(0.0, 50.0f, 0.0f));
@@ -1043,19 +1886,38 @@ ViewRenderer::ViewRenderer(Context* ctx,RenderSettings& settings_, int id, Scene
    // viewportCamera_->SetFlipVertical(true);
     currentScene_ = initialScene;
     currentScene_->SetUpdateEnabled(false);
-    // create the rendertexture for this view
-    renderTexture_ = new Texture2D(ctx_);
+    readback_ = new FrameReadback(ctx_,settings.readbackBuffers);
+    framePool_ = new FrameBufferPool(settings.readbackBuffers + 2);
+    codec_ = MAX_FRAME_CODECS;
+    lastViewChange_ = -M_INFINITY;
+    needsRefinement_ = false;
+    renderScale_ = 1.0f;
+    gpuTimer_ = new GpuTimer(ctx_);
+    frameSequence_ = 0;
+    ackedSequence_ = 0;
+    lastCreditTime_ = 0;
+    renderPending_ = false;
     SetSize(width,height,fov);
 }
 
+ViewRenderer::~ViewRenderer()
+{
+    targetPool_->Release(renderTarget_);
+    // frames still queued in zeromq keep the pool alive
+    framePool_->Destroy();
+}
+
 void ViewRenderer::SetScene(Scene *scene)
 {
     if (scene == currentScene_){
         // nothing to do
         return;
     }
-    viewport_->SetScene(scene);
-    renderSurface_->QueueUpdate();
+    currentScene_ = scene;
+    MarkDirty(VIEWDIRTY_SCENE);
+    if (renderTarget_){
+        renderTarget_->SetView(currentScene_,viewportCamera_,renderTarget_->GetRect().Width(),renderTarget_->GetRect().Height());
+    }
 }
 
 void ViewRenderer::SetOrthoMode(const Matrix4& vmat,float size_)
@@ -1096,6 +1958,7 @@ void ViewRenderer::SetViewData(bool ortho,const Vector3 &pos, const Vector3 &dir
     Quaternion quat;
     quat.FromLookRotation(Vector3(-dir.y_,dir.z_,dir.x_),Vector3(-up.y_,up.z_,up.x_));
     viewportCameraNode_->SetRotation(quat);
+    MarkDirty(VIEWDIRTY_CAMERA);
 
     auto _pos = viewportCameraNode_->GetPosition();
     auto _rot = viewportCameraNode_->GetRotation().EulerAngles();
@@ -1131,7 +1994,7 @@ void ViewRenderer::SetViewMatrix(const Vector3& t,const Vector3& r,const Vector3
     auto rot = viewportCameraNode_->GetRotation().EulerAngles();
     URHO3D_LOGINFOF("ROTATION:%s",rot.ToString().CString());
 
-    renderSurface_->QueueUpdate();
+    MarkDirty(VIEWDIRTY_CAMERA);
 }
 
 void ViewRenderer::SetSize(int width, int height, float fov)
@@ -1139,31 +2002,175 @@ void ViewRenderer::SetSize(int width, int height, float fov)
     width_ = width;
     height_ = height;
     fov_ = fov;
+    MarkDirty(VIEWDIRTY_CAMERA);
 
     viewportCamera_->SetFov(fov);
+    ResizeRenderTexture();
+}
+
+void ViewRenderer::SetRenderScale(float scale)
+{
+    if (scale == renderScale_){
+        return;
+    }
+    renderScale_ = scale;
+    ResizeRenderTexture();
+}
+
+void ViewRenderer::AddFrameCost(float readTime, float scale)
+{
+    if (gpuTimer_->IsSupported()){
+        float gpuTime;
+        float gpuScale;
+        if (gpuTimer_->GetResult(gpuTime,gpuScale)){
+            dynamicResolution_.AddSample(gpuTime,gpuScale);
+        }
+    } else {
+        // copying the pixels grows with the pixel count as well, unlike the cpu time of the render
+        dynamicResolution_.AddSample(readTime,scale);
+    }
+}
+
+void ViewRenderer::ResizeRenderTexture()
+{
+    if (atlasMode_){
+        // the atlas places the view with its current render size
+        return;
+    }
+    int width = GetRenderWidth();
+    int height = GetRenderHeight();
+    if (renderTarget_ && width == renderTarget_->GetRect().Width() && height == renderTarget_->GetRect().Height()){
+        return;
+    }
+
+    // within the bucket only the viewport rect changes, otherwise swap in a pooled target
+    if (!RenderTargetPool::Fits(renderTarget_,width,height)){
+        RenderTarget* target = targetPool_->Acquire(width,height);
+        target->GetViewport()->SetRenderPath(renderPath_);
+        targetPool_->Release(renderTarget_);
+        renderTarget_ = target;
+    }
+    renderTarget_->SetView(currentScene_,viewportCamera_,width,height);
+}
 
-    bool result = renderTexture_->SetSize(width,height,Graphics::GetRGBAFormat(), TEXTURE_RENDERTARGET);
-    renderTexture_->SetFilterMode(FILTER_BILINEAR);
-    renderSurface_ = renderTexture_->GetRenderSurface();
-    viewport_ = new Viewport(ctx_, currentScene_, viewportCamera_);
-    renderSurface_->SetViewport(0, viewport_);
-    renderSurface_->SetUpdateMode(SURFACE_MANUALUPDATE);
-    renderSurface_->QueueUpdate();
+void ViewRenderer::SetRenderPath(RenderPath* renderPath)
+{
+    renderPath_ = renderPath;
+    if (renderTarget_){
+        renderTarget_->GetViewport()->SetRenderPath(renderPath_);
+    }
+}
+
+void ViewRenderer::SetAtlasMode(bool atlasMode)
+{
+    if (atlasMode == atlasMode_){
+        return;
+    }
+    atlasMode_ = atlasMode;
+    if (atlasMode_){
+        targetPool_->Release(renderTarget_);
+        renderTarget_.Reset();
+    } else {
+        ResizeRenderTexture();
+    }
+    // the next frame comes on the other path, blender has no reference frame there
+    tileEncoder_.RequestKeyframe();
+}
+
+void ViewRenderer::SetInputTrace(const LatencyTrace& trace)
+{
+    // an input that was not rendered yet is superseded by the newer one
+    inputTrace_ = trace;
 }
 
 void ViewRenderer::RequestRender()
 {
+    if (inputTrace_.IsValid() && !inputTrace_.stamps_[STAGE_RENDER_QUEUED]){
+        inputTrace_.Stamp(STAGE_RENDER_QUEUED);
+    }
     if (settings.showPhysics) {
         PhysicsWorld* pw = currentScene_->GetComponent<PhysicsWorld>(true);
         pw->DrawDebugGeometry(settings.showPhysicsDepth);
     }
-    renderSurface_->QueueUpdate();
+    // in atlas mode the atlas queues the update once all views of the frame are known
+    if (renderTarget_){
+        renderTarget_->GetSurface()->QueueUpdate();
+    }
+}
+
+void ViewRenderer::QueueReadback()
+{
+    FrameInfo info;
+    PrepareFrame(info);
+    // only the rect of the view, the texture may be bigger
+    readback_->Queue(renderTarget_->GetTexture(),renderTarget_->GetReadbackRect(),info);
+}
+
+void ViewRenderer::PrepareFrame(FrameInfo& info)
+{
+    info.fov_ = viewportCamera_->GetFov();
+    info.initialFov_ = fov_;
+    info.interactive_ = IsInteracting();
+    info.viewWidth_ = width_;
+    info.viewHeight_ = height_;
+    info.scale_ = renderScale_;
+
+    if (frameSequence_ == ackedSequence_){
+        lastCreditTime_ = ctx_->GetSubsystem<Time>()->GetElapsedTime();
+    }
+    metrics_.framesRendered_++;
+    info.sequence_ = ++frameSequence_;
+    info.renderTimestamp_ = GetMonotonicUSec();
+    if (inputTrace_.IsValid()){
+        // called from E_ENDALLVIEWSRENDER
+        inputTrace_.stamps_[STAGE_RENDERED] = info.renderTimestamp_;
+        info.trace_ = inputTrace_;
+        inputTrace_ = LatencyTrace();
+    }
+}
+
+void ViewRenderer::NotifyViewChanged()
+{
+    lastViewChange_ = ctx_->GetSubsystem<Time>()->GetElapsedTime();
+}
+
+bool ViewRenderer::IsInteracting() const
+{
+    return ctx_->GetSubsystem<Time>()->GetElapsedTime() - lastViewChange_ < settings.idleTime;
+}
+
+void ViewRenderer::Acknowledge(unsigned sequence)
+{
+    if (sequence > ackedSequence_){
+        ackedSequence_ = Min(sequence,frameSequence_);
+        lastCreditTime_ = ctx_->GetSubsystem<Time>()->GetElapsedTime();
+    }
+}
+
+bool ViewRenderer::HasCredit()
+{
+    if (!settings.maxFramesInFlight || frameSequence_ - ackedSequence_ < settings.maxFramesInFlight){
+        return true;
+    }
+    // acks got lost or blender went away, don't stall the view forever
+    float now = ctx_->GetSubsystem<Time>()->GetElapsedTime();
+    if (now - lastCreditTime_ > settings.ackTimeout){
+        URHO3D_LOGWARNINGF("view %i: no ack for %.2fs, restoring credit",viewId_,now - lastCreditTime_);
+        ackedSequence_ = frameSequence_;
+        lastCreditTime_ = now;
+        return true;
+    }
+    return false;
 }
 
 void ViewRenderer::Show()
 {
     Renderer* renderer = ctx_->GetSubsystem<Renderer>();
     Viewport* viewport = renderer->GetViewport(0);
+    if (!viewport){
+        // server mode
+        return;
+    }
     viewport->SetScene(currentScene_);
     viewport->SetCamera(viewportCamera_);
 }
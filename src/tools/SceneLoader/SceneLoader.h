@@ -26,6 +26,22 @@
 #include<Urho3D/AngelScript/Script.h>
 #include<Urho3D/Urho3DAll.h>
 
+#include "FrameReadback.h"
+#include "FrameBufferPool.h"
+#include "RenderTargetPool.h"
+#include "ViewAtlas.h"
+#include "SceneChangeTracker.h"
+#include "TileDeltaEncoder.h"
+#include "FrameCodec.h"
+#include "DynamicResolution.h"
+#include "GpuTimer.h"
+#include "FrameHeader.h"
+#include "ViewMessage.h"
+#include "LatencyStats.h"
+#include "RuntimeMetrics.h"
+#include "BenchmarkClient.h"
+#include <SessionLog.h>
+
 namespace Urho3D
 {
 
@@ -35,15 +51,66 @@ class Scene;
 
 }
 
+class BlenderMessage;
+
 struct RenderSettings {
     bool showPhysics;
     bool showPhysicsDepth;
     bool activatePhysics;
+    /// amount of staging buffers used to read back the frames of each view
+    unsigned readbackBuffers;
+    /// only send the tiles that changed since the last frame
+    bool deltaTiles;
+    unsigned tileSize;
+    /// send a full frame every n frames
+    unsigned keyframeInterval;
+    /// compression used for views that did not choose one
+    FrameCodecType codec;
+    /// send cheap lossy frames while the view is moving and a lossless one once it stopped
+    bool progressive;
+    /// seconds without view update after which a view counts as idle
+    float idleTime;
+    /// render moving views with a reduced resolution to hold targetFrameTime (seconds)
+    bool dynamicResolution;
+    float targetFrameTime;
+    float minScale;
+    /// frames a view may have queued/sent without acknowledgement from blender (0 = no limit)
+    unsigned maxFramesInFlight;
+    /// seconds without acknowledgement after which the credit is restored anyway
+    float ackTimeout;
+    /// send frames as 'frame' messages with a binary FrameHeader instead of 'draw' with json meta
+    bool binaryHeader;
+    /// render all views into one texture that is read back and sent as one 'atlas' message
+    bool atlas;
+};
+
+/// Identifies a view of a blender instance: view ids are only unique per client.
+struct ViewKey
+{
+    ViewKey() : viewId_(0) {}
+    ViewKey(StringHash client,int viewId) : client_(client), viewId_(viewId) {}
+
+    bool operator ==(const ViewKey& rhs) const { return client_ == rhs.client_ && viewId_ == rhs.viewId_; }
+    bool operator !=(const ViewKey& rhs) const { return !(*this == rhs); }
+    unsigned ToHash() const { return client_.Value() * 31 + (unsigned)viewId_; }
+
+    /// hash of the client id, 0 for blender instances that don't send one
+    StringHash client_;
+    int viewId_;
+};
+
+/// Why a view has to be rendered again, see ViewRenderer::MarkDirty().
+enum ViewDirtyFlags {
+    VIEWDIRTY_CAMERA = 1,
+    /// something changed within the view's frustum
+    VIEWDIRTY_SCENE = 2,
+    VIEWDIRTY_SETTINGS = 4
 };
 
 class ViewRenderer{
 public:
-    ViewRenderer(Context* ctx,RenderSettings& settings,int id, Scene* initialScene, int width,int height,float fov);
+    ViewRenderer(Context* ctx,RenderSettings& settings,RenderTargetPool* targetPool,const String& client,int id, Scene* initialScene, int width,int height,float fov);
+    ~ViewRenderer();
     void SetSize(int width,int height,float fov);
     void SetScene(Scene* scene);
     void SetViewMatrix(const Matrix4& vmat);
@@ -51,18 +118,72 @@ public:
     void SetOrthoMode(const Matrix4& vmat,float size_);
     void SetPerspMode(const Matrix4& vmat);
     void SetViewData(bool orthoMode,const Vector3& pos,const Vector3& dir,const Vector3& up,float orthosize, float fov);
-    inline SharedPtr<Texture2D> GetRenderTexture(){ return renderTexture_;}
+    inline Texture2D* GetRenderTexture(){ return renderTarget_ ? renderTarget_->GetTexture() : nullptr;}
     inline int GetId() { return viewId_;}
+    /// client id of the blender instance the view belongs to (empty if it sent none)
+    inline const String& GetClient() const { return client_; }
+    inline ViewKey GetKey() const { return ViewKey(StringHash(client_),viewId_); }
+    inline RenderSettings& GetSettings() { return settings; }
     inline SharedPtr<Scene> GetScene() { return currentScene_; }
     inline SharedPtr<Camera> GetCamera() { return viewportCamera_;}
-    inline SharedPtr<Viewport> GetViewport() { return viewport_;}
+    inline Viewport* GetViewport() { return renderTarget_ ? renderTarget_->GetViewport() : nullptr;}
+    void SetRenderPath(RenderPath* renderPath);
+    inline RenderPath* GetRenderPath() const { return renderPath_; }
+    /// size the view renders with (view size times render scale)
+    inline int GetRenderWidth() const { return Max(RoundToInt(width_ * renderScale_),1); }
+    inline int GetRenderHeight() const { return Max(RoundToInt(height_ * renderScale_),1); }
     const String& GetNetId() { return netId; }
     void RequestRender();
+    /// request a render with the next flush of dirty views (once per frame, before rendering)
+    inline void MarkDirty(unsigned flags) { dirtyFlags_ |= flags; }
+    inline unsigned GetDirtyFlags() const { return dirtyFlags_; }
+    inline void ClearDirty() { dirtyFlags_ = 0; }
+    /// copy the last rendered frame into the next staging buffer (picked up later via GetReadback())
+    void QueueReadback();
+    /// describe the frame rendered this frame and count it as in flight (done by QueueReadback())
+    void PrepareFrame(FrameInfo& info);
+    /// the view is rendered by the ViewAtlas of its client and has no render target of its own
+    void SetAtlasMode(bool atlasMode);
+    inline bool IsAtlasMode() const { return atlasMode_; }
+    inline FrameReadback* GetReadback() { return readback_; }
+    inline FrameBufferPool* GetFramePool() { return framePool_; }
+    inline TileDeltaEncoder& GetTileEncoder() { return tileEncoder_; }
+    /// set the codec for this view (MAX_FRAME_CODECS to use the one from the settings)
+    inline void SetCodec(FrameCodecType codec) { codec_ = codec; }
+    inline FrameCodecType GetCodec() const { return codec_ < MAX_FRAME_CODECS ? codec_ : settings.codec; }
     void Show();
+    /// blender moved the camera or resized the view
+    void NotifyViewChanged();
+    /// true if the last view change is less than settings.idleTime ago
+    bool IsInteracting() const;
+    /// the last frame was sent lossy and needs a lossless refinement once the view is idle
+    inline void SetNeedsRefinement(bool needsRefinement) { needsRefinement_ = needsRefinement; }
+    inline bool NeedsRefinement() const { return needsRefinement_; }
+    /// render with a fraction of the view size (1 = full resolution)
+    void SetRenderScale(float scale);
+    inline float GetRenderScale() const { return renderScale_; }
+    inline DynamicResolution& GetDynamicResolution() { return dynamicResolution_; }
+    /// measures the gpu time of the renders of this view
+    inline GpuTimer* GetGpuTimer() { return gpuTimer_; }
+    /// feed the dynamic resolution with the newest gpu time, or the readback time of a frame with the given scale
+    /// if there are no timer queries
+    void AddFrameCost(float readTime,float scale);
+    /// blender drew the frame with this sequence number (and all before)
+    void Acknowledge(unsigned sequence);
+    /// true if less than settings.maxFramesInFlight frames are unacknowledged
+    bool HasCredit();
+    /// a render was requested while there was no credit
+    inline void SetRenderPending(bool renderPending) { renderPending_ = renderPending; }
+    inline bool IsRenderPending() const { return renderPending_; }
+    /// input that changed the view, carried to the next frame of the view
+    void SetInputTrace(const LatencyTrace& trace);
+    inline LatencyStats& GetLatencyStats() { return latencyStats_; }
+    inline ViewMetrics& GetMetrics() { return metrics_; }
         float fov_;
 private:
 
     String netId;
+    String client_;
     int viewId_;
     int width_;
     int height_;
@@ -73,11 +194,38 @@ private:
 
     Context* ctx_;
     SharedPtr<Scene> currentScene_;
-    SharedPtr<RenderSurface> renderSurface_;
-    SharedPtr<Texture2D> renderTexture_;
-    SharedPtr<Viewport> viewport_;
+    /// pooled texture and viewport, sized to the bucket of the render size
+    SharedPtr<RenderTargetPool> targetPool_;
+    SharedPtr<RenderTarget> renderTarget_;
+    /// render path of the view, null for the default one
+    SharedPtr<RenderPath> renderPath_;
+    bool atlasMode_;
+    unsigned dirtyFlags_;
     SharedPtr<Node> viewportCameraNode_;
     SharedPtr<Camera> viewportCamera_;
+    SharedPtr<FrameReadback> readback_;
+    /// buffers the frames are read into and sent from
+    FrameBufferPool* framePool_;
+    TileDeltaEncoder tileEncoder_;
+    FrameCodecType codec_;
+    /// time of the last view change (Time::GetElapsedTime)
+    float lastViewChange_;
+    bool needsRefinement_;
+    float renderScale_;
+    SharedPtr<GpuTimer> gpuTimer_;
+    DynamicResolution dynamicResolution_;
+    /// sequence number of the last queued frame
+    unsigned frameSequence_;
+    unsigned ackedSequence_;
+    /// last time credit came back (or the first frame went in flight)
+    float lastCreditTime_;
+    bool renderPending_;
+    /// newest input not rendered yet
+    LatencyTrace inputTrace_;
+    LatencyStats latencyStats_;
+    ViewMetrics metrics_;
+
+    void ResizeRenderTexture();
 };
 
 /// Scene & UI load example.
@@ -93,6 +241,8 @@ public:
     /// Construct.
     explicit SceneLoader(Context* context);
 
+    /// Setup before engine initialization (--server changes the window parameters).
+    void Setup() override;
     /// Setup after engine initialization and before running the main loop.
     void Start() override;
     void Stop() override;
@@ -117,6 +267,13 @@ private:
     void ExportComponents(const String& outputPaht);
 
     void HandleUpdate(StringHash eventType, VariantMap& eventData);
+    void HandlePostUpdate(StringHash eventType, VariantMap& eventData);
+    /// idle scheduler: sleeps until blender sends something if there is nothing to do
+    void HandleEndFrame(StringHash eventType, VariantMap& eventData);
+    /// true if a view has to render or send something, or a scene simulates
+    bool HasPendingWork();
+    /// the scene runs physics or plays animations
+    bool IsSceneActive(Scene* scene);
     void HandlePostRenderUpdate(StringHash eventType, VariantMap& eventData);
 
 
@@ -130,22 +287,47 @@ private:
 
     void HandleAfterSingleRender(StringHash eventType, VariantMap& eventData);
     void HandleAfterRender(StringHash eventType, VariantMap& eventData);
-
-    void HandleBlenderMSG(StringHash eventType, VariantMap& eventData);
-
-
-    /// render the view and send it back to blender
-    void HandleRenderRequestFromBlender(const JSONObject &json);
-    void HandleSettingsRequestFromBlender(const JSONObject &json);
+    void HandleBeginViewRender(StringHash eventType, VariantMap& eventData);
+    void HandleEndViewRender(StringHash eventType, VariantMap& eventData);
+    /// send all frames of this view whose readback is finished. wait=true blocks for the oldest one
+    void SendFinishedFrames(ViewRenderer* view,bool wait=false);
+    /// encode the frame and send it to blender (takes ownership of the buffer)
+    void SendFrame(ViewRenderer* view,FrameBuffer* frame,const FrameInfo& info);
+    /// same as SendFinishedFrames() for the frames of an atlas
+    void SendFinishedAtlasFrames(ViewAtlas* atlas,bool wait=false);
+    /// send the atlas with its rect table as one message (takes ownership of the buffer)
+    void SendAtlasFrame(ViewAtlas* atlas,FrameBuffer* frame,const FrameInfo& info,const Vector<AtlasEntry>& layout);
+
+    /// blender message handlers (registered at the BlenderNetwork)
+    void HandleViewMSG(BlenderMessage& message);
+    void HandleDataChangeMSG(BlenderMessage& message);
+    void HandleSettingsMSG(BlenderMessage& message);
+    void HandleAckMSG(BlenderMessage& message);
+
+
+    /// render the view and send it back to blender (client: see BlenderMessage::GetClient())
+    void HandleRenderRequestFromBlender(const String& client,const JSONObject &json,LatencyTrace& trace);
+    void HandleSettingsRequestFromBlender(const String& client,const JSONObject &json);
+    void HandleAckFromBlender(StringHash client,const JSONObject &json);
+    /// binary camera update of an existing view
+    void HandleViewUpdateFromBlender(StringHash client,const ViewMessage& view,LatencyTrace& trace);
 
     void UpdateCameras();
     void EnsureLight(Scene* scene);
 
 
     Scene* GetScene(const String& sceneName);
-    ViewRenderer* GetViewRenderer(int viewId);
+    ViewRenderer* GetViewRenderer(const ViewKey& key);
+    /// settings of a blender instance, starting as a copy of the defaults
+    RenderSettings& GetClientSettings(StringHash client);
+    ViewAtlas* GetViewAtlas(const ViewRenderer* view);
     ViewRenderer* CreateViewRenderer(Context* ctx, Scene* scene, int width, int height);
-    void UpdateAllViewRenderers(Scene* scene=nullptr);
+    /// render the views marked dirty, changes of their scenes mark the views that see them
+    void FlushDirtyViews();
+    /// start tracking the changes of the scene of a view
+    void TrackScene(Scene* scene);
+    /// make room in the shared memory ring for the frames all views may have in flight
+    void ReserveFrameSlots();
     void UpdateViewRenderer(ViewRenderer* renderer);
 
 
@@ -157,7 +339,11 @@ private:
   //  void HandleRequestFromBlender(const JSONObject& json);
 //    void HandleRequestFromEngineToBlender();
 
+    /// defaults of all clients and the scene wide settings (physics)
     RenderSettings settings;
+    /// each blender instance sets up its views on its own. a HashMap doesn't move its values, the
+    /// views keep references
+    HashMap<StringHash,RenderSettings> clientSettings_;
 
     String sceneName;
     Vector<String> runtimeFlags;
@@ -185,8 +371,13 @@ private:
     SharedPtr<Texture2D> rtTexture;
 
     HashMap<StringHash,Scene*> scenes_;
-    HashMap<int,ViewRenderer*> viewRenderers;
+    HashMap<ViewKey,ViewRenderer*> viewRenderers;
     HashSet<ViewRenderer*> updatedRenderers;
+    /// changes of the scenes that have views
+    HashMap<Scene*,SharedPtr<SceneChangeTracker> > sceneTrackers_;
+    PODVector<BoundingBox> changedBounds_;
+    /// atlas of each client that has views in atlas mode
+    HashMap<StringHash,SharedPtr<ViewAtlas> > atlases_;
     ViewRenderer* currentViewRenderer;
 
     bool currentRenderPathDefault;
@@ -194,5 +385,29 @@ private:
     SharedPtr<RenderPath> defaultRenderpath;
 
     JSONFile jsonfile_;
+    PODVector<unsigned> changedTiles_;
+    FrameHeader frameHeader_;
+    PODVector<unsigned char> frameHeaderData_;
+    FrameCodec frameCodec_;
+    SharedPtr<RuntimeMetrics> metrics_;
+    /// render textures of all views
+    SharedPtr<RenderTargetPool> renderTargets_;
+    /// --replay: publishes a recorded session in place of blender
+    UniquePtr<SessionReplayer> replayer_;
+    /// --replayexit: seconds to keep running after the replay finished, negative to keep running
+    float replayExitDelay_;
+    /// --benchmark: fake blender client, the results are written to benchmarkPath_
+    UniquePtr<BenchmarkClient> benchmark_;
+    String benchmarkPath_;
+    /// --server: hidden window, no viewport 0, UI or debug hud. Only the views are rendered
+    bool serverMode_;
+    /// sleep between frames while there is no work (--noidle to render continuously)
+    bool idleMode_;
+    /// seconds the idle loop sleeps at most, file changes are picked up at this interval
+    float idleWakeInterval_;
+    /// seconds of full frame rate after the last work, it usually comes in bursts
+    float idleDelay_;
+    /// Time::GetElapsedTime() when there was work the last time
+    float lastActivityTime_;
 
 };
@@ -0,0 +1,229 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "SharedMemoryRing.h"
+
+#include <Urho3D/IO/Log.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/// increased on every Create of any ring, part of the name
+static unsigned generation = 0;
+/// retired segments kept at most, the oldest is dropped even if a reader never picked up its frames
+static const unsigned MAX_RETIRED = 4;
+/// usec after which an unread slot counts as lost
+static const unsigned long long STALE_TIMEOUT = 2000000;
+
+static unsigned long long GetSteadyUSec()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+SharedMemoryRing::SharedMemoryRing()
+    : nextSlot_(0)
+    , sequence_(0)
+{
+}
+
+SharedMemoryRing::~SharedMemoryRing()
+{
+    Destroy();
+}
+
+bool SharedMemoryRing::Create(unsigned numSlots, unsigned slotSize)
+{
+#ifdef _WIN32
+    URHO3D_LOGWARNING("SharedMemoryRing: not supported on this platform");
+    return false;
+#else
+    if (current_.memory_){
+        retired_.Push(current_);
+        current_ = Segment();
+        if (retired_.Size() > MAX_RETIRED){
+            URHO3D_LOGWARNINGF("SharedMemoryRing: %s still has unread frames, dropping it",retired_.Front().name_.CString());
+            Unmap(retired_.Front());
+            retired_.Erase(0);
+        }
+    }
+
+    Segment segment;
+    segment.name_ = "/urho3d-runtime-" + String((unsigned)getpid()) + "-" + String(generation++);
+    segment.numSlots_ = Max(numSlots,1U);
+    segment.slotSize_ = (slotSize + 63) & ~63U;
+    segment.memorySize_ = HEADER_SIZE + segment.numSlots_ * (SLOT_HEADER_SIZE + segment.slotSize_);
+    segment.writeTimes_.Resize(segment.numSlots_);
+
+    int fd = shm_open(segment.name_.CString(),O_CREAT | O_RDWR | O_TRUNC,0600);
+    if (fd < 0){
+        URHO3D_LOGERRORF("SharedMemoryRing: shm_open(%s) failed",segment.name_.CString());
+        return false;
+    }
+    if (ftruncate(fd,segment.memorySize_) != 0){
+        URHO3D_LOGERRORF("SharedMemoryRing: could not resize %s to %u bytes",segment.name_.CString(),segment.memorySize_);
+        close(fd);
+        shm_unlink(segment.name_.CString());
+        return false;
+    }
+    void* memory = mmap(nullptr,segment.memorySize_,PROT_READ | PROT_WRITE,MAP_SHARED,fd,0);
+    close(fd);
+    if (memory == MAP_FAILED){
+        URHO3D_LOGERRORF("SharedMemoryRing: could not map %s",segment.name_.CString());
+        shm_unlink(segment.name_.CString());
+        return false;
+    }
+    // ftruncate fills with zeros: every slot has sequence 0 and counts as read
+    segment.memory_ = static_cast<unsigned char*>(memory);
+
+    unsigned version = VERSION;
+    memcpy(segment.memory_,"U3DS",4);
+    memcpy(segment.memory_ + 4,&version,4);
+    memcpy(segment.memory_ + 8,&segment.numSlots_,4);
+    memcpy(segment.memory_ + 12,&segment.slotSize_,4);
+    current_ = segment;
+    nextSlot_ = 0;
+
+    URHO3D_LOGINFOF("SharedMemoryRing: created %s (%u slots a %u bytes)",current_.name_.CString(),current_.numSlots_,current_.slotSize_);
+    return true;
+#endif
+}
+
+void SharedMemoryRing::Destroy()
+{
+    for (Segment& segment : retired_){
+        Unmap(segment);
+    }
+    retired_.Clear();
+    Unmap(current_);
+}
+
+bool SharedMemoryRing::Reserve(unsigned numSlots)
+{
+    if (!current_.memory_ || numSlots <= current_.numSlots_){
+        return true;
+    }
+    return Create(numSlots,current_.slotSize_);
+}
+
+bool SharedMemoryRing::Write(const unsigned char* data, unsigned size, unsigned& slot, unsigned long long& sequence)
+{
+    if (!current_.memory_){
+        return false;
+    }
+    ReleaseRetired();
+    if (size > current_.slotSize_ && !Create(current_.numSlots_,size)){
+        return false;
+    }
+
+    // never overwrite a frame the reader did not pick up yet
+    unsigned long long now = GetSteadyUSec();
+    unsigned numSlots = current_.numSlots_;
+    unsigned i = 0;
+    while (i < numSlots && !IsSlotFree(current_,(nextSlot_ + i) % numSlots,now)){
+        i++;
+    }
+    if (i == numSlots){
+        return false;
+    }
+    slot = (nextSlot_ + i) % numSlots;
+    nextSlot_ = (slot + 1) % numSlots;
+    current_.writeTimes_[slot] = now;
+    sequence_++;
+
+    unsigned char* slotMemory = GetSlotMemory(current_,slot);
+    volatile unsigned long long* slotSequence = reinterpret_cast<volatile unsigned long long*>(slotMemory);
+
+    // odd while writing
+    *slotSequence = sequence_ * 2 + 1;
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(slotMemory + 16,&size,4);
+    memcpy(slotMemory + SLOT_HEADER_SIZE,data,size);
+    std::atomic_thread_fence(std::memory_order_release);
+    sequence = sequence_ * 2 + 2;
+    *slotSequence = sequence;
+    memcpy(current_.memory_ + 16,&sequence,8);
+    return true;
+}
+
+unsigned char* SharedMemoryRing::GetSlotMemory(const Segment& segment, unsigned slot)
+{
+    return segment.memory_ + HEADER_SIZE + slot * (SLOT_HEADER_SIZE + segment.slotSize_);
+}
+
+void SharedMemoryRing::Release(unsigned slot, unsigned long long sequence)
+{
+    if (!current_.memory_ || slot >= current_.numSlots_){
+        return;
+    }
+    volatile unsigned long long* slotHeader = reinterpret_cast<volatile unsigned long long*>(GetSlotMemory(current_,slot));
+    if (slotHeader[0] == sequence){
+        // as if the reader was done with it
+        slotHeader[1] = sequence;
+    }
+}
+
+bool SharedMemoryRing::IsSlotFree(const Segment& segment, unsigned slot, unsigned long long now)
+{
+    const volatile unsigned long long* slotHeader = reinterpret_cast<const volatile unsigned long long*>(GetSlotMemory(segment,slot));
+    unsigned long long written = slotHeader[0];
+    unsigned long long read = slotHeader[1];
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return written == 0 || read == written || now - segment.writeTimes_[slot] > STALE_TIMEOUT;
+}
+
+void SharedMemoryRing::Unmap(Segment& segment)
+{
+#ifndef _WIN32
+    if (!segment.memory_){
+        return;
+    }
+    munmap(segment.memory_,segment.memorySize_);
+    shm_unlink(segment.name_.CString());
+    segment.memory_ = nullptr;
+#endif
+}
+
+void SharedMemoryRing::ReleaseRetired()
+{
+    unsigned long long now = GetSteadyUSec();
+    for (unsigned i=0; i < retired_.Size();){
+        Segment& segment = retired_[i];
+        bool read = true;
+        for (unsigned slot=0; slot < segment.numSlots_ && read; slot++){
+            read = IsSlotFree(segment,slot,now);
+        }
+        if (read){
+            Unmap(segment);
+            retired_.Erase(i);
+        } else {
+            i++;
+        }
+    }
+}
@@ -0,0 +1,100 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Container/RefCounted.h>
+#include <Urho3D/Container/Str.h>
+#include <Urho3D/Container/Vector.h>
+
+using namespace Urho3D;
+
+/// Ring of frame slots in posix shared memory, for blender instances running on the same host.
+/// The pixels are written into a slot and only a small control message (name, slot, size,
+/// sequence) goes over zeromq. Layout (little endian):
+///
+///   header:  char magic[4] "U3DS", uint32 version, uint32 numSlots, uint32 slotSize, uint64 lastSequence
+///   slot[i]: uint64 sequence, uint64 readSequence, uint32 size, uint32 reserved[3], slotSize bytes data
+///
+/// Slot i starts at HEADER_SIZE + i * (SLOT_HEADER_SIZE + slotSize). The sequence of a slot is
+/// odd while it is written. A reader copies the data, checks afterwards that the sequence still
+/// matches the one from the control message and then stores that sequence as readSequence. Only
+/// slots that were read are written again, if there is none the frame goes over tcp instead.
+/// Control messages can get lost (pub/sub drops them without subscriber or at the high water mark),
+/// so a slot that stays unread for STALE_TIMEOUT is taken anyway. A reader that still copies it
+/// notices the changed sequence.
+///
+/// Growing the ring creates a new segment with a new name. The old one stays mapped (and linked)
+/// until the reader read all of its slots, so control messages still on the way remain valid.
+class SharedMemoryRing : public RefCounted
+{
+public:
+    static const unsigned HEADER_SIZE = 32;
+    static const unsigned SLOT_HEADER_SIZE = 32;
+    static const unsigned VERSION = 2;
+
+    SharedMemoryRing();
+    ~SharedMemoryRing() override;
+
+    /// Create the shared memory. An existing segment is retired, see above. Returns false if shared memory is not available.
+    bool Create(unsigned numSlots,unsigned slotSize);
+    /// Unmap and unlink the shared memory, including retired segments.
+    void Destroy();
+    /// Make room for at least numSlots frames in flight. Only grows.
+    bool Reserve(unsigned numSlots);
+    /// Copy data into the next slot the reader is done with. The ring is recreated (new name) if the data
+    /// does not fit. Returns false if all slots are still unread or the ring could not be recreated (IsCreated()).
+    bool Write(const unsigned char* data,unsigned size,unsigned& slot,unsigned long long& sequence);
+    /// The control message of the slot could not be sent, the slot is free again.
+    void Release(unsigned slot,unsigned long long sequence);
+
+    inline bool IsCreated() const { return current_.memory_ != nullptr; }
+    /// name to pass to shm_open on the reading side
+    inline const String& GetName() const { return current_.name_; }
+    inline unsigned GetNumSlots() const { return current_.numSlots_; }
+
+private:
+    struct Segment {
+        Segment() : memory_(nullptr), memorySize_(0), numSlots_(0), slotSize_(0) {}
+
+        String name_;
+        unsigned char* memory_;
+        unsigned memorySize_;
+        unsigned numSlots_;
+        unsigned slotSize_;
+        /// steady clock (usec) of the last write of every slot
+        PODVector<unsigned long long> writeTimes_;
+    };
+
+    static unsigned char* GetSlotMemory(const Segment& segment,unsigned slot);
+    /// the reader is done with the slot, it was never written or it is stale (see above)
+    static bool IsSlotFree(const Segment& segment,unsigned slot,unsigned long long now);
+    static void Unmap(Segment& segment);
+    /// unmap the retired segments that were read completely
+    void ReleaseRetired();
+
+    Segment current_;
+    /// older segments with frames the reader may not have read yet
+    Vector<Segment> retired_;
+    unsigned nextSlot_;
+    unsigned long long sequence_;
+};
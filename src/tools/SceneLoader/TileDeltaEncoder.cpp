@@ -0,0 +1,133 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "TileDeltaEncoder.h"
+
+#include <Urho3D/Math/MathDefs.h>
+
+#include <cstring>
+
+TileDeltaEncoder::TileDeltaEncoder(unsigned tileSize, unsigned keyframeInterval)
+    : tileSize_(Max(tileSize,1U))
+    , keyframeInterval_(keyframeInterval)
+    , framesSinceKeyframe_(0)
+    , keyframeRequested_(true)
+    , width_(0)
+    , height_(0)
+    , tilesX_(0)
+    , tilesY_(0)
+{
+}
+
+void TileDeltaEncoder::SetParameters(unsigned tileSize, unsigned keyframeInterval)
+{
+    tileSize = Max(tileSize,1U);
+    if (tileSize != tileSize_){
+        tileSize_ = tileSize;
+        width_ = height_ = 0;
+        keyframeRequested_ = true;
+    }
+    keyframeInterval_ = keyframeInterval;
+}
+
+bool TileDeltaEncoder::Encode(const unsigned char* rgba, int width, int height, PODVector<unsigned>& changedTiles)
+{
+    changedTiles.Clear();
+
+    unsigned frameSize = width * height * 4;
+    bool keyframe = keyframeRequested_ || width != width_ || height != height_
+            || (keyframeInterval_ && framesSinceKeyframe_ + 1 >= keyframeInterval_);
+
+    if (!keyframe){
+        unsigned numTiles = tilesX_ * tilesY_;
+        unsigned stride = width * 4;
+
+        for (unsigned tile=0; tile < numTiles; tile++){
+            int x,y,w,h;
+            GetTileRect(tile,x,y,w,h);
+            unsigned rowSize = w * 4;
+            unsigned offset = y * stride + x * 4;
+
+            int row = 0;
+            while (row < h && memcmp(rgba + offset + row * stride,&previous_[offset + row * stride],rowSize) == 0){
+                row++;
+            }
+            if (row == h){
+                continue;
+            }
+            changedTiles.Push(tile);
+            for (; row < h; row++){
+                memcpy(&previous_[offset + row * stride],rgba + offset + row * stride,rowSize);
+            }
+        }
+
+        // if most of the frame changed the tile map is not worth it
+        keyframe = changedTiles.Size() * 4 > numTiles * 3;
+        framesSinceKeyframe_++;
+    }
+
+    if (keyframe){
+        width_ = width;
+        height_ = height;
+        tilesX_ = (width + tileSize_ - 1) / tileSize_;
+        tilesY_ = (height + tileSize_ - 1) / tileSize_;
+        previous_.Resize(frameSize);
+        memcpy(previous_.Buffer(),rgba,frameSize);
+        framesSinceKeyframe_ = 0;
+        keyframeRequested_ = false;
+        changedTiles.Clear();
+    }
+    return keyframe;
+}
+
+unsigned TileDeltaEncoder::GetPackedSize(const PODVector<unsigned>& tiles) const
+{
+    unsigned size = 0;
+    for (unsigned tile : tiles){
+        int x,y,w,h;
+        GetTileRect(tile,x,y,w,h);
+        size += w * h * 4;
+    }
+    return size;
+}
+
+void TileDeltaEncoder::PackTiles(const unsigned char* rgba, const PODVector<unsigned>& tiles, unsigned char* dest) const
+{
+    unsigned stride = width_ * 4;
+    for (unsigned tile : tiles){
+        int x,y,w,h;
+        GetTileRect(tile,x,y,w,h);
+        unsigned rowSize = w * 4;
+        for (int row=0; row < h; row++){
+            memcpy(dest,rgba + (y + row) * stride + x * 4,rowSize);
+            dest += rowSize;
+        }
+    }
+}
+
+void TileDeltaEncoder::GetTileRect(unsigned tile, int& x, int& y, int& w, int& h) const
+{
+    x = (tile % tilesX_) * tileSize_;
+    y = (tile / tilesX_) * tileSize_;
+    w = Min((int)tileSize_,width_ - x);
+    h = Min((int)tileSize_,height_ - y);
+}
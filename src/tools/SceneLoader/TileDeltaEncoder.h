@@ -0,0 +1,64 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Container/Vector.h>
+
+using namespace Urho3D;
+
+/// Splits rgba frames into tiles and finds the tiles that changed since the previous frame, so
+/// only those have to be streamed to blender. A full frame (keyframe) is requested on the first
+/// frame, after a resize, every keyframeInterval frames and when most of the tiles changed anyway.
+class TileDeltaEncoder
+{
+public:
+    TileDeltaEncoder(unsigned tileSize=32,unsigned keyframeInterval=60);
+
+    /// Change tile size and keyframe interval. Forces a keyframe if something changed.
+    void SetParameters(unsigned tileSize,unsigned keyframeInterval);
+    /// Force the next frame to be a keyframe.
+    inline void RequestKeyframe() { keyframeRequested_ = true; }
+    /// Compare the frame with the previous one. Returns true for a keyframe, otherwise changedTiles
+    /// holds the (row-major) indices of the tiles that differ.
+    bool Encode(const unsigned char* rgba,int width,int height,PODVector<unsigned>& changedTiles);
+    /// Size in bytes of the packed tiles.
+    unsigned GetPackedSize(const PODVector<unsigned>& tiles) const;
+    /// Copy the pixels of the given tiles tile by tile (row by row inside a tile) into dest.
+    void PackTiles(const unsigned char* rgba,const PODVector<unsigned>& tiles,unsigned char* dest) const;
+
+    inline unsigned GetTileSize() const { return tileSize_; }
+
+private:
+    void GetTileRect(unsigned tile,int& x,int& y,int& w,int& h) const;
+
+    unsigned tileSize_;
+    unsigned keyframeInterval_;
+    unsigned framesSinceKeyframe_;
+    bool keyframeRequested_;
+    int width_;
+    int height_;
+    unsigned tilesX_;
+    unsigned tilesY_;
+    /// last frame as blender knows it
+    PODVector<unsigned char> previous_;
+};
@@ -0,0 +1,164 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "ViewAtlas.h"
+#include "SceneLoader.h"
+
+#include <Urho3D/Container/Sort.h>
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Graphics/RenderSurface.h>
+#include <Urho3D/Graphics/Viewport.h>
+#include <Urho3D/IO/Log.h>
+
+#include <cmath>
+
+static bool CompareEntryHeight(const AtlasEntry& lhs,const AtlasEntry& rhs)
+{
+    return lhs.view_->GetRenderHeight() > rhs.view_->GetRenderHeight();
+}
+
+ViewAtlas::ViewAtlas(Context* ctx, RenderTargetPool* targetPool, const String& client, unsigned numBuffers)
+    : ctx_(ctx)
+    , clientId_(client)
+    , targetPool_(targetPool)
+    , frameSequence_(0)
+{
+    netId_ = client.Empty() ? "runtime-atlas" : "runtime:"+client+"-atlas";
+    readback_ = new FrameReadback(ctx,numBuffers);
+    framePool_ = new FrameBufferPool(numBuffers + 2);
+}
+
+ViewAtlas::~ViewAtlas()
+{
+    targetPool_->Release(renderTarget_);
+    // frames still queued in zeromq keep the pool alive
+    framePool_->Destroy();
+}
+
+void ViewAtlas::Add(ViewRenderer* view)
+{
+    for (const AtlasEntry& entry : entries_){
+        if (entry.view_ == view){
+            return;
+        }
+    }
+    AtlasEntry entry;
+    entry.view_ = view;
+    entries_.Push(entry);
+}
+
+void ViewAtlas::Render(PODVector<ViewRenderer*>& rejected)
+{
+    if (entries_.Empty()){
+        return;
+    }
+
+    // roughly square, but at least as wide as the widest view
+    int maxWidth = 0;
+    float area = 0;
+    for (const AtlasEntry& entry : entries_){
+        maxWidth = Max(maxWidth,entry.view_->GetRenderWidth());
+        area += (float)entry.view_->GetRenderWidth() * entry.view_->GetRenderHeight();
+    }
+    int atlasWidth = Min(Max(maxWidth,(int)sqrtf(area)),MAX_SIZE);
+
+    // each shelf is as high as its first view, the ones after it are not higher
+    Sort(entries_.Begin(),entries_.End(),CompareEntryHeight);
+    int x = 0;
+    int y = 0;
+    int shelfHeight = 0;
+    int usedWidth = 0;
+    for (unsigned i = 0; i < entries_.Size();){
+        AtlasEntry& entry = entries_[i];
+        int width = entry.view_->GetRenderWidth();
+        int height = entry.view_->GetRenderHeight();
+        if (x + width > atlasWidth){
+            y += shelfHeight;
+            x = 0;
+            shelfHeight = 0;
+        }
+        if (width > atlasWidth || y + height > MAX_SIZE){
+            rejected.Push(entry.view_);
+            entries_.Erase(i);
+            continue;
+        }
+        entry.rect_ = IntRect(x,y,x + width,y + height);
+        x += width;
+        shelfHeight = Max(shelfHeight,height);
+        usedWidth = Max(usedWidth,x);
+        ++i;
+    }
+    if (entries_.Empty()){
+        return;
+    }
+    usedRect_ = IntRect(0,0,usedWidth,y + shelfHeight);
+
+    // the set of views changes from frame to frame, keep the texture as long as it is big enough
+    if (!renderTarget_ || renderTarget_->GetWidth() < usedRect_.Width() || renderTarget_->GetHeight() < usedRect_.Height()){
+        targetPool_->Release(renderTarget_);
+        renderTarget_ = targetPool_->Acquire(usedRect_.Width(),usedRect_.Height());
+    }
+
+    renderTarget_->SetNumViews(entries_.Size());
+    for (unsigned i = 0; i < entries_.Size(); ++i){
+        ViewRenderer* view = entries_[i].view_;
+        renderTarget_->SetView(i,view->GetScene(),view->GetCamera(),entries_[i].rect_);
+        renderTarget_->GetViewport(i)->SetRenderPath(view->GetRenderPath());
+    }
+    renderTarget_->GetSurface()->QueueUpdate();
+}
+
+void ViewAtlas::QueueReadback()
+{
+    if (entries_.Empty()){
+        return;
+    }
+
+    // only the part covered by views, the texture may be bigger
+    IntRect readRect = renderTarget_->ToReadbackRect(usedRect_);
+    for (AtlasEntry& entry : entries_){
+        entry.view_->PrepareFrame(entry.info_);
+        IntRect rect = renderTarget_->ToReadbackRect(entry.rect_);
+        entry.readbackRect_ = IntRect(rect.left_ - readRect.left_,rect.top_ - readRect.top_,
+                                      rect.right_ - readRect.left_,rect.bottom_ - readRect.top_);
+    }
+
+    FrameInfo info;
+    info.sequence_ = ++frameSequence_;
+    info.renderTimestamp_ = GetMonotonicUSec();
+    readback_->Queue(renderTarget_->GetTexture(),readRect,info);
+
+    queuedLayouts_.Push(entries_);
+    entries_.Clear();
+}
+
+FrameBuffer* ViewAtlas::ReadFrame(FrameInfo& info, Vector<AtlasEntry>& layout, bool wait)
+{
+    if (!readback_->IsReady(info,wait)){
+        return nullptr;
+    }
+    FrameBuffer* frame = framePool_->Acquire(info.dataSize_);
+    readback_->Read(frame->data_);
+    layout = queuedLayouts_.Front();
+    queuedLayouts_.PopFront();
+    return frame;
+}
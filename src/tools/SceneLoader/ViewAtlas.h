@@ -0,0 +1,109 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "FrameInfo.h"
+
+#include <Urho3D/Container/List.h>
+#include <Urho3D/Container/Ptr.h>
+#include <Urho3D/Container/RefCounted.h>
+#include <Urho3D/Container/Str.h>
+#include <Urho3D/Container/Vector.h>
+#include <Urho3D/Math/Rect.h>
+#include <Urho3D/Math/StringHash.h>
+
+namespace Urho3D
+{
+class Context;
+}
+
+using namespace Urho3D;
+
+class FrameBufferPool;
+class FrameReadback;
+class RenderTarget;
+class RenderTargetPool;
+class ViewRenderer;
+struct FrameBuffer;
+
+/// A view rendered into the atlas.
+struct AtlasEntry {
+    AtlasEntry()
+        : view_(nullptr)
+    {}
+
+    ViewRenderer* view_;
+    /// rect of the view in the atlas texture (top left origin like Viewport::GetRect())
+    IntRect rect_;
+    /// rect of the view in the pixels read back (rows in texture memory order)
+    IntRect readbackRect_;
+    FrameInfo info_;
+};
+
+/// Renders the views of one blender instance that update in the same frame side by side into one
+/// pooled render target, so all of them are read back with one copy and sent as one 'atlas'
+/// message with a rect table. The views are packed into shelves, highest first.
+class ViewAtlas : public RefCounted
+{
+public:
+    /// the atlas doesn't grow beyond MAX_SIZE x MAX_SIZE, views that don't fit wait for the next frame
+    static const int MAX_SIZE = 8192;
+
+    ViewAtlas(Context* ctx,RenderTargetPool* targetPool,const String& client,unsigned numBuffers=2);
+    ~ViewAtlas() override;
+
+    /// render the view in the atlas this frame
+    void Add(ViewRenderer* view);
+    /// Place the added views and queue the update of the atlas. Views that did not fit are
+    /// removed and added to rejected.
+    void Render(PODVector<ViewRenderer*>& rejected);
+    /// Copy the rendered views into the next staging buffer and start a new frame. The readback must not be full.
+    void QueueReadback();
+    /// Read the oldest finished frame into a buffer of the frame pool, layout gets the views it
+    /// contains. Returns null if it is not finished. wait=true blocks until the gpu is done.
+    FrameBuffer* ReadFrame(FrameInfo& info,Vector<AtlasEntry>& layout,bool wait=false);
+
+    inline bool IsEmpty() const { return entries_.Empty(); }
+    inline const Vector<AtlasEntry>& GetEntries() const { return entries_; }
+    inline FrameReadback* GetReadback() { return readback_; }
+    inline FrameBufferPool* GetFramePool() { return framePool_; }
+    /// 'runtime-atlas', or 'runtime:<client>-atlas' for blender instances with a client id
+    inline const String& GetNetId() const { return netId_; }
+    inline StringHash GetClientId() const { return clientId_; }
+
+private:
+    Context* ctx_;
+    String netId_;
+    StringHash clientId_;
+    SharedPtr<RenderTargetPool> targetPool_;
+    SharedPtr<RenderTarget> renderTarget_;
+    SharedPtr<FrameReadback> readback_;
+    FrameBufferPool* framePool_;
+    /// views of the current frame
+    Vector<AtlasEntry> entries_;
+    /// part of the texture the views of the current frame cover
+    IntRect usedRect_;
+    /// layouts of the frames in the readback, oldest first
+    List<Vector<AtlasEntry> > queuedLayouts_;
+    unsigned frameSequence_;
+};
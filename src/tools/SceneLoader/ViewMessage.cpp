@@ -0,0 +1,135 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "ViewMessage.h"
+
+#include <cstring>
+
+static_assert(sizeof(Matrix4) == 64 && sizeof(Vector3) == 12, "ViewMessage expects tightly packed math types");
+
+static const char* MAGIC = "U3DV";
+
+template <class T> static inline const unsigned char* Get(const unsigned char* src,T& value)
+{
+    // the runtime only runs on little endian hosts, so this is the wire format as is
+    memcpy(&value,src,sizeof(T));
+    return src + sizeof(T);
+}
+
+template <class T> static inline unsigned char* Put(unsigned char* dest,const T& value)
+{
+    memcpy(dest,&value,sizeof(T));
+    return dest + sizeof(T);
+}
+
+ViewMessage::ViewMessage()
+    : version_(VERSION)
+    , flags_(0)
+    , viewId_(-1)
+    , fov_(45.0f)
+    , orthoSize_(0.0f)
+    , width_(0)
+    , height_(0)
+    , inputSeq_(0)
+    , clientTime_(0)
+{
+}
+
+bool ViewMessage::Read(const unsigned char* data, unsigned size)
+{
+    if (size < SIZE_V1 || memcmp(data,MAGIC,4)!=0){
+        return false;
+    }
+    const unsigned char* p = data + 4;
+    unsigned short version;
+    unsigned short flags;
+    p = Get(p,version);
+    if (version < 1 || version > VERSION || (version == VERSION && size < SIZE)){
+        return false;
+    }
+    version_ = version;
+    p = Get(p,flags);
+    flags_ = flags;
+    p = Get(p,viewId_);
+    p = Get(p,viewMatrix_);
+    p = Get(p,perspectiveMatrix_);
+    p = Get(p,position_);
+    p = Get(p,direction_);
+    p = Get(p,up_);
+    p = Get(p,fov_);
+    p = Get(p,orthoSize_);
+    p = Get(p,width_);
+    p = Get(p,height_);
+    if (version >= 2){
+        p = Get(p,inputSeq_);
+        Get(p + 4,clientTime_);
+    } else {
+        inputSeq_ = 0;
+        clientTime_ = 0;
+    }
+    return true;
+}
+
+void ViewMessage::Write(unsigned char* dest) const
+{
+    unsigned char* p = dest;
+    memcpy(p,MAGIC,4);
+    p += 4;
+    p = Put<unsigned short>(p,version_);
+    p = Put<unsigned short>(p,flags_);
+    p = Put(p,viewId_);
+    p = Put(p,viewMatrix_);
+    p = Put(p,perspectiveMatrix_);
+    p = Put(p,position_);
+    p = Put(p,direction_);
+    p = Put(p,up_);
+    p = Put(p,fov_);
+    p = Put(p,orthoSize_);
+    p = Put(p,width_);
+    if (version_ < 2){
+        Put(p,height_);
+        return;
+    }
+    p = Put(p,height_);
+    p = Put(p,inputSeq_);
+    p = Put<unsigned>(p,0);
+    Put(p,clientTime_);
+}
+
+void ViewMessage::Merge(const ViewMessage& older)
+{
+    if ((older.flags_ & VIEWFLAG_RESOLUTION) && !(flags_ & VIEWFLAG_RESOLUTION)){
+        flags_ |= VIEWFLAG_RESOLUTION;
+        width_ = older.width_;
+        height_ = older.height_;
+    }
+}
+
+int ViewMessage::PeekViewId(const unsigned char* data, unsigned size)
+{
+    if (size < SIZE_V1 || memcmp(data,MAGIC,4)!=0){
+        return -1;
+    }
+    int viewId;
+    Get(data + 8,viewId);
+    return viewId;
+}
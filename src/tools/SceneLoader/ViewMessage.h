@@ -0,0 +1,93 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Math/Matrix4.h>
+#include <Urho3D/Math/Vector3.h>
+
+using namespace Urho3D;
+
+enum ViewMessageFlags {
+    /// orthographic view, orthoSize_ is valid
+    VIEWFLAG_ORTHO = 1,
+    /// width_, height_ are valid and the view has to be resized
+    VIEWFLAG_RESOLUTION = 2,
+};
+
+/// Camera update of a blender view in a packed binary layout (subtype 'view', datatype 'bin').
+/// Replaces the json 'data_change' on the navigation path; json stays as fallback and is still
+/// needed to create a view.
+///
+///   offset  type        field
+///    0      char[4]     magic "U3DV"
+///    4      uint16      version
+///    6      uint16      flags (ViewMessageFlags)
+///    8      int32       view id
+///   12      float32[16] view matrix (row-major)
+///   76      float32[16] perspective matrix (row-major)
+///  140      float32[3]  view position (blender coordinates)
+///  152      float32[3]  view direction
+///  164      float32[3]  view up
+///  176      float32     fov
+///  180      float32     ortho size (view distance)
+///  184      uint32      width
+///  188      uint32      height
+///  192      uint32      input sequence (version 2, 0 = not traced)
+///  196      uint32      reserved
+///  200      uint64      client timestamp (version 2, blender's clock, echoed in the frame header)
+///
+/// All values are little endian. Version 1 messages end after the height.
+struct ViewMessage
+{
+    static const unsigned VERSION = 2;
+    static const unsigned SIZE = 208;
+    static const unsigned SIZE_V1 = 192;
+
+    ViewMessage();
+
+    /// Decode from the wire (version 1 or 2). Returns false if size, magic or version don't match.
+    bool Read(const unsigned char* data,unsigned size);
+    /// Encode to the wire in version_ layout, dest has to hold SIZE (SIZE_V1) bytes.
+    void Write(unsigned char* dest) const;
+    /// Take over the resolution of an older message that is replaced by this one.
+    void Merge(const ViewMessage& older);
+
+    /// view id of an encoded message without decoding it. Returns -1 if it is not a valid message.
+    static int PeekViewId(const unsigned char* data,unsigned size);
+
+    /// layout version, VERSION unless it was read from an older message
+    unsigned version_;
+    unsigned flags_;
+    int viewId_;
+    Matrix4 viewMatrix_;
+    Matrix4 perspectiveMatrix_;
+    Vector3 position_;
+    Vector3 direction_;
+    Vector3 up_;
+    float fov_;
+    float orthoSize_;
+    unsigned width_;
+    unsigned height_;
+    unsigned inputSeq_;
+    unsigned long long clientTime_;
+};